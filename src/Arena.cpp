@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include "Arena.h"
+
+const size_t Arena::ALIGNMENT;
+const size_t Arena::BLOCKSIZE;
+
+Arena::Arena() : current(0), offset(0), used(0)
+{
+
+}
+
+Arena::~Arena()
+{
+  Release();
+}
+
+void Arena::Release()
+{
+  for (const Block& block:blocks)
+    std::free(block.data);
+  blocks.clear();
+}
+
+void * Arena::Allocate(size_t bytes)
+{
+  bytes = std::max((bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT, ALIGNMENT);
+  used += bytes;
+  // the rest of a block, which is too small, is skipped
+  for (; current < blocks.size(); ++current, offset = 0)
+  {
+    if (blocks[current].size - offset >= bytes)
+    {
+      void * memory = blocks[current].data + offset;
+      offset += bytes;
+      return memory;
+    }
+  }
+  size_t size = std::max(bytes, BLOCKSIZE);
+  void * memory = nullptr;
+  if (posix_memalign(&memory, ALIGNMENT, size) != 0)
+    throw std::bad_alloc();
+  blocks.push_back({static_cast<char *>(memory), size});
+  current = blocks.size() - 1;
+  offset = bytes;
+  return memory;
+}
+
+void Arena::Reset()
+{
+  // several blocks are merged and an oversized one is shrunk to what the command used
+  size_t wanted = std::max(used, BLOCKSIZE);
+  if (blocks.size() > 1 || (blocks.size() == 1 && blocks[0].size > 4 * wanted))
+  {
+    Release();
+    void * memory = nullptr;
+    if (posix_memalign(&memory, ALIGNMENT, wanted) != 0)
+      throw std::bad_alloc();
+    blocks.push_back({static_cast<char *>(memory), wanted});
+  }
+  current = 0;
+  offset = 0;
+  used = 0;
+}
+
+size_t Arena::GetCapacity() const
+{
+  size_t capacity = 0;
+  for (const Block& block:blocks)
+    capacity += block.size;
+  return capacity;
+}
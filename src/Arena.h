@@ -0,0 +1,94 @@
+/**
+* @file         Arena.h
+* @date         18.10.2026
+* @brief        Definition of the Arena
+* @author       miklilad
+*/
+#ifndef SEM_ARENA_H
+#define SEM_ARENA_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+* @class    Arena
+* @brief    Scratch memory of one command
+* @details  Allocations are served from big aligned blocks by moving a pointer and are never freed
+* @details  one by one, all of them are released at once by Reset. Reset keeps one block sized to what
+* @details  the finished command used, so repeated commands don't allocate from the heap at all.
+* @details  Memory is uninitialized and no constructors or destructors are run, so it suits plain
+* @details  buffers of numbers, which mustn't be used after Reset. Arena isn't thread-safe.
+*/
+class Arena
+{
+  /**
+  * @struct   Block
+  * @brief    One allocation from the heap
+  */
+  struct Block
+  {
+    char * data;
+    size_t size;
+  };
+
+  std::vector<Block> blocks;
+  size_t current;
+  size_t offset;
+  size_t used;
+
+  /**
+  * @fn        Release
+  * @brief     Returns all blocks to the heap
+  */
+  void Release();
+
+public:
+  /**
+  * Alignment of every allocation in bytes (one cache line)
+  */
+  static const size_t ALIGNMENT = 64;
+
+  /**
+  * Smallest block taken from the heap
+  */
+  static const size_t BLOCKSIZE = 1 << 20;
+
+  Arena();
+
+  Arena(const Arena& other) = delete;
+
+  Arena& operator=(const Arena& other) = delete;
+
+  ~Arena();
+
+  /**
+  * @fn        Allocate
+  * @returns   Aligned uninitialized memory of bytes, valid until Reset
+  */
+  void * Allocate(size_t bytes);
+
+  /**
+  * @fn        Allocate
+  * @returns   Uninitialized array of count elements of trivial type T, valid until Reset
+  */
+  template<typename T>
+  T * Allocate(size_t count)
+  {
+    return static_cast<T *>(Allocate(count * sizeof(T)));
+  }
+
+  /**
+  * @fn        Reset
+  * @brief     Frees every allocation at once
+  */
+  void Reset();
+
+  /**
+  * @fn        GetCapacity
+  * @returns   Bytes held from the heap
+  */
+  size_t GetCapacity() const;
+};
+
+
+#endif
@@ -0,0 +1,195 @@
+#include <stdexcept>
+#include <vector>
+#include "BlockMatrix.h"
+
+BlockMatrix::BlockMatrix(const Matrix& first, const Matrix& second, Direction direction)
+    : Matrix(direction == HORIZONTAL ? first.GetWidth() + second.GetWidth() : first.GetWidth(),
+             direction == HORIZONTAL ? first.GetHeight() : first.GetHeight() + second.GetHeight()),
+      first(first.GetCopy()), second(second.GetCopy()), direction(direction)
+{
+  if ((direction == HORIZONTAL && first.GetHeight() != second.GetHeight()) ||
+      (direction == VERTICAL && first.GetWidth() != second.GetWidth()))
+    throw std::exception();
+}
+
+BlockMatrix::BlockMatrix(Matrix * first, Matrix * second, Direction direction)
+    : Matrix(direction == HORIZONTAL ? first->GetWidth() + second->GetWidth() : first->GetWidth(),
+             direction == HORIZONTAL ? first->GetHeight() : first->GetHeight() + second->GetHeight()),
+      first(first), second(second), direction(direction)
+{
+  if ((direction == HORIZONTAL && first->GetHeight() != second->GetHeight()) ||
+      (direction == VERTICAL && first->GetWidth() != second->GetWidth()))
+    throw std::exception();
+}
+
+BlockMatrix::BlockMatrix(const BlockMatrix& other) : Matrix(other.width, other.height),
+                                                     first(other.first->GetCopy()),
+                                                     second(other.second->GetCopy()), direction(other.direction)
+{
+
+}
+
+Matrix * BlockMatrix::Locate(int& coordinate, bool vertical) const
+{
+  if (vertical != (direction == VERTICAL))
+    return nullptr;
+  int offset = vertical ? first->GetHeight() : first->GetWidth();
+  if (coordinate < offset)
+    return first.get();
+  coordinate -= offset;
+  return second.get();
+}
+
+long long BlockMatrix::Bound(const Matrix& m)
+{
+  return (long long) m.GetWidth() * m.GetHeight();
+}
+
+const Matrix& BlockMatrix::GetFirst() const
+{
+  return *first;
+}
+
+const Matrix& BlockMatrix::GetSecond() const
+{
+  return *second;
+}
+
+BlockMatrix::Direction BlockMatrix::GetDirection() const
+{
+  return direction;
+}
+
+int BlockMatrix::GetOffsetX() const
+{
+  return direction == HORIZONTAL ? first->GetWidth() : 0;
+}
+
+int BlockMatrix::GetOffsetY() const
+{
+  return direction == VERTICAL ? first->GetHeight() : 0;
+}
+
+double BlockMatrix::At(int x, int y) const
+{
+  const Matrix * block = direction == HORIZONTAL ? Locate(x, false) : Locate(y, true);
+  return block->At(x, y);
+}
+
+void BlockMatrix::SetAt(int x, int y, double val)
+{
+  Matrix * block = direction == HORIZONTAL ? Locate(x, false) : Locate(y, true);
+  block->SetAt(x, y, val);
+}
+
+Matrix * BlockMatrix::GetCopy() const
+{
+  return new BlockMatrix(*this);
+}
+
+void BlockMatrix::Transpose()
+{
+  first->Transpose();
+  second->Transpose();
+  direction = direction == HORIZONTAL ? VERTICAL : HORIZONTAL;
+  int num = width;
+  width = height;
+  height = num;
+}
+
+void BlockMatrix::SwapRows(int row1, int row2)
+{
+  if (row1 >= height || row2 >= height || row1 < 0 || row2 < 0)
+    throw std::exception();
+  if (direction == HORIZONTAL)
+  {
+    first->SwapRows(row1, row2);
+    second->SwapRows(row1, row2);
+    return;
+  }
+  Matrix * block1 = Locate(row1, true);
+  Matrix * block2 = Locate(row2, true);
+  if (block1 == block2)
+  {
+    block1->SwapRows(row1, row2);
+    return;
+  }
+  // rows in different blocks are exchanged through buffers, the one moved to row2 is negated
+  std::vector<double> buffer1(width), buffer2(width);
+  block1->CopyRowTo(row1, buffer1.data());
+  block2->CopyRowTo(row2, buffer2.data());
+  for (int x = 0; x < width; ++x)
+  {
+    block1->SetAt(x, row1, buffer2[x]);
+    block2->SetAt(x, row2, buffer1[x] != 0 ? -buffer1[x] : 0);
+  }
+}
+
+void BlockMatrix::ScalarMul(double num)
+{
+  first->ScalarMul(num);
+  second->ScalarMul(num);
+}
+
+void BlockMatrix::CopyTo(double * buffer, int ld) const
+{
+  first->CopyTo(buffer, ld);
+  second->CopyTo(buffer + (size_t) GetOffsetX() * ld + GetOffsetY(), ld);
+}
+
+void BlockMatrix::FillFrom(const double * buffer, int ld)
+{
+  first->FillFrom(buffer, ld);
+  second->FillFrom(buffer + (size_t) GetOffsetX() * ld + GetOffsetY(), ld);
+}
+
+void BlockMatrix::CopyRowTo(int y, double * buffer) const
+{
+  const Matrix * block = Locate(y, true);
+  if (block != nullptr)
+  {
+    block->CopyRowTo(y, buffer);
+    return;
+  }
+  first->CopyRowTo(y, buffer);
+  second->CopyRowTo(y, buffer + GetOffsetX());
+}
+
+void BlockMatrix::CopyColumnTo(int x, double * buffer) const
+{
+  const Matrix * block = Locate(x, false);
+  if (block != nullptr)
+  {
+    block->CopyColumnTo(x, buffer);
+    return;
+  }
+  first->CopyColumnTo(x, buffer);
+  second->CopyColumnTo(x, buffer + GetOffsetY());
+}
+
+long long BlockMatrix::GetNonZeroCount() const
+{
+  return first->GetNonZeroCount() + second->GetNonZeroCount();
+}
+
+long long BlockMatrix::ReadNonZeros(long long cursor, Entry * out, int max, int& count) const
+{
+  long long bound = Bound(*first);
+  count = 0;
+  if (cursor < bound)
+  {
+    long long next = first->ReadNonZeros(cursor, out, max, count);
+    if (next != -1)
+      return next;
+    return Bound(*second) > 0 ? bound : -1;
+  }
+  long long next = second->ReadNonZeros(cursor - bound, out, max, count);
+  int offsetX = GetOffsetX();
+  int offsetY = GetOffsetY();
+  for (int i = 0; i < count; ++i)
+  {
+    out[i].x += offsetX;
+    out[i].y += offsetY;
+  }
+  return next == -1 ? -1 : next + bound;
+}
@@ -0,0 +1,131 @@
+/**
+* @file         BlockMatrix.h
+* @date         18.10.2026
+* @brief        Definition of the BlockMatrix
+* @author       miklilad
+*/
+#ifndef SEM_BLOCKMATRIX_H
+#define SEM_BLOCKMATRIX_H
+
+#include <memory>
+#include "Matrix.h"
+
+/**
+* @class    BlockMatrix
+* @brief    Two matricies side by side [first second] or one above the other [first; second]
+* @details  Blocks are copies of the merged matricies, which share their storage (see Matrix::GetCopy),
+* @details  so merging costs O(1) memory, and they may be BlockMatricies again. Every operation is
+* @details  forwarded to the blocks: bulk copies write each block to its part of the buffer with its own
+* @details  (memcpy for dense) routine, NonZeroIterator reads the first block and then the second.
+* @details  Kernels, which need one storage, get a contiguous copy by CopyTo.
+*/
+class BlockMatrix : public Matrix
+{
+public:
+  /**
+  * @enum     Direction
+  * @brief    HORIZONTAL - second block is right of the first one, VERTICAL - below it
+  */
+  enum Direction
+  {
+    HORIZONTAL, VERTICAL
+  };
+
+private:
+  std::unique_ptr<Matrix> first;
+  std::unique_ptr<Matrix> second;
+  Direction direction;
+
+  /**
+  * @fn        Locate
+  * @brief     Finds the block of element x,y of the given axis and moves the coordinate into the block
+  * @param     vertical - True for y coordinate, false for x
+  * @returns   The block or nullptr, if the whole row (column) is in both blocks
+  */
+  Matrix * Locate(int& coordinate, bool vertical) const;
+
+  /**
+  * @fn        Bound
+  * @returns   Upper bound of the ReadNonZeros cursors of m
+  */
+  static long long Bound(const Matrix& m);
+
+public:
+  /**
+  * @brief     Merges copies of first and second
+  * @details   Throws std::exception, if their heights (HORIZONTAL) or widths (VERTICAL) differ.
+  */
+  BlockMatrix(const Matrix& first, const Matrix& second, Direction direction);
+
+  /**
+  * @brief     Merges first and second, which are deleted by the BlockMatrix
+  */
+  BlockMatrix(Matrix * first, Matrix * second, Direction direction);
+
+  BlockMatrix(const BlockMatrix& other);
+
+  /**
+  * @fn        GetFirst
+  * @returns   Upper-left block
+  */
+  const Matrix& GetFirst() const;
+
+  /**
+  * @fn        GetSecond
+  * @returns   Block right of or below the first one
+  */
+  const Matrix& GetSecond() const;
+
+  /**
+  * @fn        GetDirection
+  * @returns   Where the second block is
+  */
+  Direction GetDirection() const;
+
+  /**
+  * @fn        GetOffsetX
+  * @returns   Column of the matrix, where the second block starts
+  */
+  int GetOffsetX() const;
+
+  /**
+  * @fn        GetOffsetY
+  * @returns   Row of the matrix, where the second block starts
+  */
+  int GetOffsetY() const;
+
+  double At(int x, int y) const override;
+
+  void SetAt(int x, int y, double val) override;
+
+  Matrix * GetCopy() const override;
+
+  /**
+  * @fn        Transpose
+  * @brief     Transposes both blocks and changes the direction, [A B]^T = [A^T; B^T]
+  */
+  void Transpose() override;
+
+  void SwapRows(int row1, int row2) override;
+
+  void ScalarMul(double num) override;
+
+  void CopyTo(double * buffer, int ld) const override;
+
+  void FillFrom(const double * buffer, int ld) override;
+
+  void CopyRowTo(int y, double * buffer) const override;
+
+  void CopyColumnTo(int x, double * buffer) const override;
+
+  long long GetNonZeroCount() const override;
+
+  /**
+  * @fn        ReadNonZeros
+  * @details   Cursors below Bound(first) belong to the first block, the rest to the second one.
+  */
+  long long ReadNonZeros(long long cursor, Entry * out, int max, int& count) const override;
+};
+
+
+#endif
@@ -5,111 +5,162 @@ const int COLORCOUNT = 7;
 
 void Calculator::PrintMatrix(Matrix * m, Matrix * colors) const
 {
-  int x = m->GetWidth();
-  int y = m->GetHeight();
-  std::vector<int> max;
-  for (int i = 0; i < x; ++i)
+  if (colors == nullptr || !m->SameSize(*colors))
   {
-    max.push_back(DoubleLength(m->At(i, 0)));
-    for (int j = 1; j < y; ++j)
-    {
-      int length = DoubleLength(m->At(i, j));
-      if (length > max[i])
-        max[i] = length;
-    }
+    printer.Print(*m);
+    return;
   }
-  if (colors == nullptr || !m->SameSize(*colors))
+  // colored matrix is printed element by element, each value is formatted once
+  int x = m->GetWidth();
+  int y = m->GetHeight();
+  std::vector<std::string> texts((size_t) x * y);
+  std::vector<int> max(x, 0);
+  char text[MatrixPrinter::MAXLENGTH];
+  for (int j = 0; j < x; ++j)
   {
     for (int i = 0; i < y; ++i)
     {
-      for (int j = 0; j < x; ++j)
-        os << std::setw(max[j] + 1) << m->At(j, i);
-      os << std::endl;
+      std::string& value = texts[(size_t) j * y + i];
+      value.assign(text, MatrixPrinter::Format(m->At(j, i), text));
+      max[j] = std::max(max[j], (int) value.size());
     }
   }
-  else
+  for (int i = 0; i < y; ++i)
   {
-    for (int i = 0; i < y; ++i)
+    for (int j = 0; j < x; ++j)
     {
-      for (int j = 0; j < x; ++j)
-      {
-        DoubleToSetColor(colors->At(j, i));
-        os << std::setw(max[j] + 1) << m->At(j, i);
-        OsReset();
-      }
-      os << std::endl;
+      const std::string& value = texts[(size_t) j * y + i];
+      DoubleToSetColor(colors->At(j, i));
+      os << std::string(max[j] + 1 - value.size(), ' ') << value;
+      OsReset();
     }
+    os << '\n';
   }
 }
 
-Calculator::Calculator(std::ostream& os) : os(os)
+void Calculator::SetPrintLimit(int limit, int edge)
+{
+  printer.SetLimit(limit, edge);
+}
+
+int Calculator::GetPrintLimit() const
+{
+  return printer.GetLimit();
+}
+
+int Calculator::GetPrintEdge() const
+{
+  return printer.GetEdge();
+}
+
+Calculator::Calculator(std::ostream& os, bool colors) : os(os), colors(colors), printer(os)
+{
+
+}
+
+void Calculator::ResetArena()
 {
+  arena.Reset();
+}
 
+DenseMatrix Calculator::Scratch(int width, int height) const
+{
+  int ld = DenseMatrix::LeadingDimension(height);
+  double * buffer = arena.Allocate<double>((size_t) width * ld);
+  // the buffer is released by the arena
+  return DenseMatrix(width, height, std::shared_ptr<double>(buffer, [](double *) {}), ld);
 }
 
 Matrix * Calculator::GEM(const Matrix& m, bool commentary = false) const
 {
-  Matrix * copy = m.GetCopy();
-  int width = copy->GetWidth();
-  int height = copy->GetHeight();
-  DenseMatrix colors(width, height);
+  int width = m.GetWidth();
+  int height = m.GetHeight();
+  DenseMatrix * copy;
+  if (!commentary)
+  {
+    // Same steps without printing, done by panels and GEMM updates
+    copy = LUDecomposition(m, LUDecomposition::GEM, &pool).Echelon();
+    if (typeid(SparseMatrix) != typeid(m))
+      return copy;
+    Matrix * sparse = new SparseMatrix(width, height);
+    sparse->FillFrom(copy->Data(), copy->GetLeadingDimension());
+    delete copy;
+    return sparse;
+  }
+  copy = new DenseMatrix(width, height);
+  m.CopyTo(copy->Data(), copy->GetLeadingDimension());
+  DenseMatrix colors = Scratch(width, height);
+  std::fill(colors.Data(), colors.Data() + (size_t) width * colors.GetLeadingDimension(), 0);
+  double * ratios = arena.Allocate<double>(height);
+  // colors of the 2 swapped rows, while they are highlighted
+  double * swapped = arena.Allocate<double>(2 * width);
 
   int y = 0;
   for (int x = 0; x < width; ++x)
   {
-    int pivot = FindPivot(*copy, x, y);
+    int pivot = FindPivot(copy->Column(x), height, y);
     if (pivot == -1)
     {
-      if (commentary)
-        for (int yy = y; yy < height; ++yy)
-          colors.SetAt(x, yy, 20);
+      for (int yy = y; yy < height; ++yy)
+        colors.SetAt(x, yy, 20);
       continue;
     }
     if (pivot != y)
     {
       copy->SwapRows(y, pivot);
-      if (commentary)
+      OsBold();
+      os << "r" << y + 1 << "<->" << "-r" << pivot + 1 << '\n';
+      OsReset();
+      for (int i = 0; i < width; ++i)
       {
-        OsBold();
-        os << "r" << y + 1 << "<->" << "-r" << pivot + 1 << std::endl;
-        OsReset();
-        Matrix * colorCopy = colors.GetCopy();
-        for (int i = 0; i < width; ++i)
-        {
-          colorCopy->SetAt(i, y, 10);
-          colorCopy->SetAt(i, pivot, 10);
-        }
-        PrintMatrix(copy, colorCopy);
-        os << "---------------------------------" << std::endl;
-        delete colorCopy;
+        swapped[2 * i] = colors.At(i, y);
+        swapped[2 * i + 1] = colors.At(i, pivot);
+        colors.SetAt(i, y, 10);
+        colors.SetAt(i, pivot, 10);
+      }
+      PrintMatrix(copy, &colors);
+      os << "---------------------------------\n";
+      for (int i = 0; i < width; ++i)
+      {
+        colors.SetAt(i, y, swapped[2 * i]);
+        colors.SetAt(i, pivot, swapped[2 * i + 1]);
       }
       pivot = y;
     }
-    int yy = y + 1;
-    while (yy < height)
+    double * column = copy->Column(x);
+    for (int yy = y + 1; yy < height; ++yy)
     {
-      double ratio = copy->At(x, yy) / copy->At(x, pivot);
-      copy->SetAt(x, yy, 0);
-      for (int xx = x + 1; xx < width; ++xx)
-        copy->SetAt(xx, yy, copy->At(xx, pivot) * -ratio + copy->At(xx, yy));
-      if (commentary && ratio != 0)
+      double ratio = column[yy] / column[pivot];
+      ratios[yy] = ratio;
+      column[yy] = 0;
+      if (ratio != 0)
       {
         colors.SetAt(x, yy, 20);
 
         OsBold();
         os << "r" << yy + 1 << " = " << -ratio << "*r"
-           << pivot + 1 << " + r" << yy + 1 << std::endl;
+           << pivot + 1 << " + r" << yy + 1 << '\n';
         OsReset();
       }
-      yy++;
     }
-    y++;
-    if (commentary)
+    for (int xx = x + 1; xx < width; ++xx)
     {
-      colors.SetAt(x, pivot, 9);
-      PrintMatrix(copy, &colors);
-      os << "---------------------------------" << std::endl;
+      double * col = copy->Column(xx);
+      double pivotVal = col[pivot];
+      for (int yy = y + 1; yy < height; ++yy)
+        col[yy] = pivotVal * -ratios[yy] + col[yy];
     }
+    y++;
+    colors.SetAt(x, pivot, 9);
+    PrintMatrix(copy, &colors);
+    os << "---------------------------------\n";
+  }
+  if (typeid(SparseMatrix) == typeid(m))
+  {
+    Matrix * sparse = new SparseMatrix(width, height);
+    sparse->FillFrom(copy->Data(), copy->GetLeadingDimension());
+    delete copy;
+    return sparse;
   }
   return copy;
 }
@@ -122,45 +173,103 @@ double Calculator::Abs(double num) const
 Calculator::~Calculator()
 {
   for (const auto& x:matricies)
-    delete x.second;
+  {
+    delete x.second.matrix;
+    delete x.second.lu;
+    delete x.second.sparseLu;
+  }
 }
 
-int Calculator::DoubleLength(double num) const
+Matrix * Calculator::GetVariable(const std::string& var) const
 {
-  std::ostringstream oss;
-  oss << num;
-  std::string text = oss.str();
-  return text.length();
+  const auto& it = matricies.find(var);
+  if (it == matricies.end())
+    return nullptr;
+  return it->second.matrix;
 }
 
-void Calculator::PrintVariable(const std::string& var) const
+void Calculator::SetVariable(const std::string& var, Matrix * m)
 {
-  const auto& m = matricies.find(var);
-  if (m == matricies.end())
+  const auto& it = matricies.find(var);
+  SparseLU * sparseLu = nullptr;
+  if (it != matricies.end())
   {
-    os << "Variable not declared!" << std::endl;
-    return;
+    delete it->second.matrix;
+    delete it->second.lu;
+    sparseLu = it->second.sparseLu;
+    if (sparseLu && (typeid(SparseMatrix) != typeid(*m) || !sparseLu->SamePattern(static_cast<SparseMatrix&>(*m))))
+    {
+      delete sparseLu;
+      sparseLu = nullptr;
+    }
   }
-  PrintMatrix(m->second);
+  matricies[var] = {m, nullptr, sparseLu, sparseLu != nullptr};
+}
+
+void Calculator::TransposeVariable(const std::string& var)
+{
+  Variable& variable = matricies.at(var);
+  variable.matrix->Transpose();
+  delete variable.lu;
+  variable.lu = nullptr;
+  delete variable.sparseLu;
+  variable.sparseLu = nullptr;
+}
+
+const LUDecomposition& Calculator::Factorization(const Variable& var) const
+{
+  if (var.lu == nullptr)
+    var.lu = new LUDecomposition(*var.matrix, LUDecomposition::PARTIAL, &pool);
+  return *var.lu;
+}
+
+const SparseLU * Calculator::SparseFactorization(const Variable& var) const
+{
+  if (typeid(SparseMatrix) != typeid(*var.matrix) || var.matrix->GetWidth() != var.matrix->GetHeight())
+    return nullptr;
+  const SparseMatrix& m = static_cast<const SparseMatrix&>(*var.matrix);
+  if (var.sparseLu == nullptr)
+    var.sparseLu = new SparseLU(m);
+  else if (var.refactor)
+    var.sparseLu->Refactor(m);
+  var.refactor = false;
+  return var.sparseLu->IsFactorized() ? var.sparseLu : nullptr;
+}
+
+bool Calculator::PrintVariable(const std::string& var, MatrixPrinter::Mode mode) const
+{
+  Matrix * m = GetVariable(var);
+  if (m == nullptr)
+  {
+    os << "Variable not declared!\n";
+    return false;
+  }
+  printer.Print(*m, mode);
+  return true;
 }
 
 void Calculator::OsBold() const
 {
-  os << "\033[1m";
+  if (colors)
+    os << "\033[1m";
 }
 
 void Calculator::OsFaint() const
 {
-  os << "\033[2m";
+  if (colors)
+    os << "\033[2m";
 }
 
 void Calculator::OsReset() const
 {
-  os << "\033[0m";
+  if (colors)
+    os << "\033[0m";
 }
 
 void Calculator::OsSetColor(Calculator::COLORS color, int brightness) const
 {
+  if (!colors)
+    return;
   switch (color)
   {
     case RED:     os << "\033[91m"; break;
@@ -195,18 +304,17 @@ void Calculator::DoubleToSetColor(double num) const
   OsSetColor(static_cast<COLORS>(num), brightness);
 }
 
-int Calculator::FindPivot(const Matrix& m, int col, int startIndex) const
+int Calculator::FindPivot(const double * column, int height, int startIndex) const
 {
-  int height = m.GetHeight();
   int pivot = -1;
-  while (startIndex < height && m.At(col, startIndex) == 0 )
+  while (startIndex < height && column[startIndex] == 0)
     startIndex++;
   if (startIndex < height)
     pivot = startIndex;
   startIndex++;
   while (startIndex < height)
   {
-    if (Abs(m.At(col, startIndex)) < Abs(m.At(col, pivot)) && m.At(col, startIndex) != 0)
+    if (Abs(column[startIndex]) < Abs(column[pivot]) && column[startIndex] != 0)
       pivot = startIndex;
     startIndex++;
   }
@@ -215,40 +323,32 @@ int Calculator::FindPivot(const Matrix& m, int col, int startIndex) const
 
 int Calculator::Rank(const Matrix& m) const
 {
-  Matrix * gemed = GEM(m);
-  int rank = 0;
-  int x = 0, y = 0;
-  bool yInced = false;
-  int width = gemed->GetWidth();
-  int height = gemed->GetHeight();
-  while (x < width && y < height)
+  return LUDecomposition(m, LUDecomposition::PARTIAL, &pool).GetRank();
+}
+
+int Calculator::Rank(const std::string& var) const
+{
+  return Factorization(matricies.at(var)).GetRank();
+}
+
+double Calculator::Determinant(const Matrix& m) const
+{
+  if (typeid(SparseMatrix) == typeid(m) && m.GetWidth() == m.GetHeight())
   {
-    if (gemed->At(x, y) == 0)
-    {
-      x++;
-      yInced = false;
-    }
-    else if (!yInced)
-    {
-      yInced = true;
-      y++;
-      rank++;
-    }
-    else
-      y++;
+    SparseLU sparseLu(static_cast<const SparseMatrix&>(m));
+    if (sparseLu.IsFactorized())
+      return sparseLu.Determinant();
   }
-  delete gemed;
-  return rank;
+  return LUDecomposition(m, LUDecomposition::PARTIAL, &pool).Determinant();
 }
 
-double Calculator::Determinant(const Matrix& m) const
+double Calculator::Determinant(const std::string& var) const
 {
-  Matrix * gemed = GEM(m);
-  double determinant = gemed->At(0, 0);
-  for (int i = 1; i < gemed->GetWidth(); ++i)
-    determinant *= gemed->At(i, i);
-  delete gemed;
-  return determinant;
+  const Variable& variable = matricies.at(var);
+  const SparseLU * sparseLu = SparseFactorization(variable);
+  if (sparseLu)
+    return sparseLu->Determinant();
+  return Factorization(variable).Determinant();
 }
 
 Matrix * Calculator::Merge(const Matrix& m1, const Matrix& m2, int direction) const
@@ -259,168 +359,681 @@ Matrix * Calculator::Merge(const Matrix& m1, const Matrix& m2, int direction) co
   {
     OsBold();
     OsSetColor(RED);
-    os << "Dimensions don't match!" << std::endl;
+    os << "Dimensions don't match!\n";
     OsReset();
     return nullptr;
   }
-  Matrix * newMatrix;
-  if (typeid(SparseMatrix) == typeid(m1) &&
-      typeid(SparseMatrix) == typeid(m2))
+  if (direction != 1 && direction != 2)
+    direction = m1.GetHeight() == m2.GetHeight() ? 1 : 2;
+  return new BlockMatrix(m1, m2, direction == 1 ? BlockMatrix::HORIZONTAL : BlockMatrix::VERTICAL);
+}
+
+Matrix * Calculator::Split(const Matrix& m, int x, int y, int width, int height) const
+{
+  if (typeid(DenseMatrix) == typeid(m))
+    return new DenseMatrix(static_cast<const DenseMatrix&>(m), x, y, width, height);
+  if (typeid(BlockMatrix) == typeid(m))
   {
-    if (direction == 1)
-      newMatrix = new SparseMatrix(m1.GetWidth() + m2.GetWidth(), m1.GetHeight());
-    else if (direction == 2)
-      newMatrix = new SparseMatrix(m1.GetWidth(), m1.GetHeight() + m2.GetHeight());
-    else if (m1.GetHeight() == m2.GetHeight())
-    {
-      newMatrix = new SparseMatrix(m1.GetWidth() + m2.GetWidth(), m1.GetHeight());
-      direction = 1;
-    }
-    else
+    // area inside one block is split from the block only
+    const BlockMatrix& block = static_cast<const BlockMatrix&>(m);
+    int offsetX = block.GetOffsetX();
+    int offsetY = block.GetOffsetY();
+    if (x + width <= offsetX || y + height <= offsetY)
+      return Split(block.GetFirst(), x, y, width, height);
+    if (x >= offsetX && y >= offsetY)
+      return Split(block.GetSecond(), x - offsetX, y - offsetY, width, height);
+  }
+  TripletBuilder builder(width, height);
+  if (typeid(SparseMatrix) == typeid(m))
+  {
+    const SparseMatrix& sparse = static_cast<const SparseMatrix&>(m);
+    const int * rowPtr = sparse.GetRowPointers();
+    const int * colIdx = sparse.GetColumnIndices();
+    const double * values = sparse.GetValues();
+    for (int j = 0; j < height; ++j)
     {
-      newMatrix = new SparseMatrix(m1.GetWidth(), m1.GetHeight() + m2.GetHeight());
-      direction = 2;
+      const int * begin = colIdx + rowPtr[y + j];
+      const int * end = colIdx + rowPtr[y + j + 1];
+      for (const int * it = std::lower_bound(begin, end, x); it != end && *it < x + width; ++it)
+        builder.Add(*it - x, j, values[it - colIdx]);
     }
   }
   else
   {
-    if (direction == 1)
-      newMatrix = new DenseMatrix(m1.GetWidth() + m2.GetWidth(), m1.GetHeight());
-    else if (direction == 2)
-      newMatrix = new DenseMatrix(m1.GetWidth(), m1.GetHeight() + m2.GetHeight());
-    else if (m1.GetHeight() == m2.GetHeight())
-    {
-      newMatrix = new DenseMatrix(m1.GetWidth() + m2.GetWidth(), m1.GetHeight());
-      direction = 1;
-    }
-    else
-    {
-      newMatrix = new DenseMatrix(m1.GetWidth(), m1.GetHeight() + m2.GetHeight());
-      direction = 2;
-    }
+    // every position is added once, so zeroes needn't be recorded
+    for (int i = 0; i < width; ++i)
+      for (int j = 0; j < height; ++j)
+        if (m.At(x + i, y + j) != 0)
+          builder.Add(i, j, m.At(x + i, y + j));
+  }
+  return builder.BuildPreferred();
+}
+
+Matrix * Calculator::Add(const Matrix& m1, const Matrix& m2) const
+{
+  return LinearCombination({{1, &m1}, {1, &m2}});
+}
+
+Matrix * Calculator::Subtract(const Matrix& m1, const Matrix& m2) const
+{
+  return LinearCombination({{1, &m1}, {-1, &m2}});
+}
+
+Matrix * Calculator::Axpy(double alpha, const Matrix& x, double beta, const Matrix& y) const
+{
+  return LinearCombination({{alpha, &x}, {beta, &y}});
+}
+
+Matrix * Calculator::Multiply(const Matrix& m1, const Matrix& m2) const
+{
+  if (m2.GetHeight() != m1.GetWidth())
+    return nullptr;
+  // every block row of m1 and block column of m2 gives a block of the result
+  if (typeid(BlockMatrix) == typeid(m1) &&
+      static_cast<const BlockMatrix&>(m1).GetDirection() == BlockMatrix::VERTICAL)
+  {
+    const BlockMatrix& block = static_cast<const BlockMatrix&>(m1);
+    return new BlockMatrix(Multiply(block.GetFirst(), m2), Multiply(block.GetSecond(), m2), BlockMatrix::VERTICAL);
+  }
+  if (typeid(BlockMatrix) == typeid(m2) &&
+      static_cast<const BlockMatrix&>(m2).GetDirection() == BlockMatrix::HORIZONTAL)
+  {
+    const BlockMatrix& block = static_cast<const BlockMatrix&>(m2);
+    return new BlockMatrix(Multiply(m1, block.GetFirst()), Multiply(m1, block.GetSecond()),
+                           BlockMatrix::HORIZONTAL);
+  }
+  int width = m2.GetWidth();
+  int height = m1.GetHeight();
+  int inner = m1.GetWidth();
+  bool sparse1 = typeid(SparseMatrix) == typeid(m1);
+  bool sparse2 = typeid(SparseMatrix) == typeid(m2);
+  if (sparse1 && sparse2)
+    return SparseKernels::Multiply(static_cast<const SparseMatrix&>(m1),
+                                   static_cast<const SparseMatrix&>(m2), &pool);
+  DenseMatrix * result = new DenseMatrix(width, height);
+  DenseMatrix * temp1 = nullptr;
+  DenseMatrix * temp2 = nullptr;
+  if (sparse1)
+  {
+    const DenseMatrix& d2 = ToDense(m2, temp2);
+    SparseKernels::MultiplyDense(static_cast<const SparseMatrix&>(m1), d2.Data(), d2.GetLeadingDimension(),
+                                 width, result->Data(), result->GetLeadingDimension(), &pool);
   }
-  if (direction == 1)
+  else if (sparse2)
   {
-    for (int x = 0; x < m1.GetWidth(); ++x)
-      for (int y = 0; y < m1.GetHeight(); ++y)
-        newMatrix->SetAt(x, y, m1.At(x, y));
-    for (int x = 0; x < m2.GetWidth(); ++x)
-      for (int y = 0; y < m2.GetHeight(); ++y)
-        newMatrix->SetAt(x + m1.GetWidth(), y, m2.At(x, y));
+    const DenseMatrix& d1 = ToDense(m1, temp1);
+    SparseKernels::DenseMultiply(d1.Data(), d1.GetLeadingDimension(), height,
+                                 static_cast<const SparseMatrix&>(m2), result->Data(),
+                                 result->GetLeadingDimension(), &pool);
   }
   else
   {
-    for (int x = 0; x < m1.GetWidth(); ++x)
-      for (int y = 0; y < m1.GetHeight(); ++y)
-        newMatrix->SetAt(x, y, m1.At(x, y));
-    for (int x = 0; x < m2.GetWidth(); ++x)
-      for (int y = 0; y < m2.GetHeight(); ++y)
-        newMatrix->SetAt(x, y + m1.GetHeight(), m2.At(x, y));
+    // transposed operands are read by Gemm as they are stored
+    int ld1, ld2;
+    bool trans1, trans2;
+    const double * a = ToDense(m1, temp1).GetLayout(ld1, trans1);
+    const double * b = ToDense(m2, temp2).GetLayout(ld2, trans2);
+    Gemm::Multiply(trans1, trans2, height, width, inner, 1, a, ld1, b, ld2, 0, result->Data(),
+                   result->GetLeadingDimension(), &pool);
   }
-  return newMatrix;
+  delete temp1;
+  delete temp2;
+  return result;
 }
 
-Matrix * Calculator::Split(const Matrix& m, int x, int y, int width, int height) const
+Matrix * Calculator::MultiplyChain(const std::vector<const Matrix *>& factors) const
 {
-  Matrix * splitted = new DenseMatrix(width, height);
-  int zeroCount = 0;
-  for (int i = 0; i < width; ++i)
+  if (factors.empty())
+    return nullptr;
+  for (size_t i = 1; i < factors.size(); ++i)
+    if (factors[i]->GetHeight() != factors[i - 1]->GetWidth())
+      return nullptr;
+  if (factors.size() == 1)
+    return factors[0]->GetCopy();
+  std::unique_ptr<Matrix> result;
+  MultiplyRange(factors, ChainOrder(factors), 0, (int) factors.size() - 1, result);
+  return result.release();
+}
+
+std::vector<int> Calculator::ChainOrder(const std::vector<const Matrix *>& factors) const
+{
+  int n = (int) factors.size();
+  std::vector<double> cost(n * n, 0);
+  std::vector<double> density(n * n, 1);
+  std::vector<char> sparse(n * n, 0);
+  std::vector<int> split(n * n, 0);
+  for (int i = 0; i < n; ++i)
   {
-    for (int j = 0; j < height; ++j)
+    if (typeid(SparseMatrix) != typeid(*factors[i]))
+      continue;
+    double size = (double) factors[i]->GetWidth() * factors[i]->GetHeight();
+    sparse[i * n + i] = 1;
+    density[i * n + i] = size > 0 ? factors[i]->GetNonZeroCount() / size : 0;
+  }
+  for (int length = 2; length <= n; ++length)
+    for (int first = 0; first + length <= n; ++first)
     {
-      double val = m.At(x + i, y + j);
-      splitted->SetAt(i, j, val);
-      if (val == 0)
-        zeroCount++;
+      int last = first + length - 1;
+      double height = factors[first]->GetHeight();
+      double width = factors[last]->GetWidth();
+      int best = first * n + last;
+      cost[best] = -1;
+      // from the right, so that equally expensive orders stay left to right
+      for (int k = last - 1; k >= first; --k)
+      {
+        int left = first * n + k;
+        int right = (k + 1) * n + last;
+        double inner = factors[k]->GetWidth();
+        double both = density[left] * density[right];
+        bool sparseResult = sparse[left] && sparse[right];
+        double resultDensity = 1;
+        if (sparseResult && both < 1)
+          resultDensity = -std::expm1(inner * std::log1p(-both));
+        double candidate = cost[left] + cost[right] + both * height * inner * width
+                           + resultDensity * height * width;
+        if (cost[best] < 0 || candidate < cost[best])
+        {
+          cost[best] = candidate;
+          density[best] = resultDensity;
+          sparse[best] = sparseResult;
+          split[best] = k;
+        }
+      }
     }
+  return split;
+}
+
+const Matrix& Calculator::MultiplyRange(const std::vector<const Matrix *>& factors, const std::vector<int>& split,
+                                        int first, int last, std::unique_ptr<Matrix>& temp) const
+{
+  if (first == last)
+    return *factors[first];
+  int k = split[first * factors.size() + last];
+  std::unique_ptr<Matrix> temp1, temp2;
+  const Matrix& m1 = MultiplyRange(factors, split, first, k, temp1);
+  const Matrix& m2 = MultiplyRange(factors, split, k + 1, last, temp2);
+  temp.reset(Multiply(m1, m2));
+  return *temp;
+}
+
+const DenseMatrix& Calculator::ToDense(const Matrix& m, DenseMatrix *& temp) const
+{
+  if (typeid(DenseMatrix) == typeid(m))
+    return static_cast<const DenseMatrix&>(m);
+  temp = new DenseMatrix(Scratch(m.GetWidth(), m.GetHeight()));
+  m.CopyTo(temp->Data(), temp->GetLeadingDimension());
+  return *temp;
+}
+
+const SparseMatrix& Calculator::ToSparse(const Matrix& m, SparseMatrix *& temp) const
+{
+  if (typeid(SparseMatrix) == typeid(m))
+    return static_cast<const SparseMatrix&>(m);
+  if (typeid(DenseMatrix) != typeid(m))
+  {
+    TripletBuilder builder(m.GetWidth(), m.GetHeight());
+    for (Matrix::NonZeroIterator it(m); it.Next();)
+      builder.Add(it.Get().x, it.Get().y, it.Get().val);
+    temp = builder.Build();
+    return *temp;
+  }
+  const DenseMatrix& dense = static_cast<const DenseMatrix&>(m);
+  temp = new SparseMatrix(m.GetWidth(), m.GetHeight());
+  temp->FillFrom(dense.Data(), dense.GetLeadingDimension());
+  return *temp;
+}
+
+Matrix * Calculator::Inverse(const Matrix& m) const
+{
+  if (m.GetWidth() != m.GetHeight())
+    std::__throw_invalid_argument("Not a square matrix!");
+  DenseMatrix * identity = new DenseMatrix(m.GetWidth(), m.GetHeight());
+  for (int i = 0; i < m.GetWidth(); ++i)
+    identity->SetAt(i, i, 1);
+  if (typeid(SparseMatrix) == typeid(m))
+  {
+    SparseLU sparseLu(static_cast<const SparseMatrix&>(m));
+    if (sparseLu.IsFactorized())
+      return Solve(identity, &sparseLu, nullptr);
   }
-  double referenceRatio = (double) (sizeof(double) + 2 * sizeof(int)) / sizeof(double);
-  double ratio = (double) width * height / zeroCount;
-  if (ratio < referenceRatio)
+  LUDecomposition lu(m, LUDecomposition::PARTIAL, &pool);
+  return Solve(identity, nullptr, &lu);
+}
+
+Matrix * Calculator::Inverse(const std::string& var) const
+{
+  const Variable& variable = matricies.at(var);
+  int size = variable.matrix->GetWidth();
+  if (size != variable.matrix->GetHeight())
+    std::__throw_invalid_argument("Not a square matrix!");
+  const SparseLU * sparseLu = SparseFactorization(variable);
+  DenseMatrix * identity = new DenseMatrix(size, size);
+  for (int i = 0; i < size; ++i)
+    identity->SetAt(i, i, 1);
+  if (sparseLu)
+    return Solve(identity, sparseLu, nullptr);
+  return Solve(identity, nullptr, &Factorization(variable));
+}
+
+void Calculator::Save(const std::string& var, const std::string& path) const
+{
+  const Matrix * m = GetVariable(var);
+  if (m == nullptr)
+    std::__throw_invalid_argument("Variable not used!");
+  MatrixFile::Save(*m, path);
+}
+
+Matrix * Calculator::Load(const std::string& path, bool verify) const
+{
+  return MatrixFile::Load(path, verify);
+}
+
+void Calculator::Export(const std::string& var, const std::string& path) const
+{
+  const Matrix * m = GetVariable(var);
+  if (m == nullptr)
+    std::__throw_invalid_argument("Variable not used!");
+  MatrixText::Export(*m, path);
+}
+
+Matrix * Calculator::Import(const std::string& path) const
+{
+  return MatrixText::Import(path);
+}
+
+void Calculator::CheckSystem(const Matrix& a, const Matrix& b) const
+{
+  if (a.GetWidth() != a.GetHeight())
+    std::__throw_invalid_argument("Not a square matrix!");
+  if (a.GetHeight() != b.GetHeight())
+    std::__throw_invalid_argument("Dimensions don't match!");
+}
+
+Matrix * Calculator::Solve(DenseMatrix * x, const SparseLU * sparseLu, const LUDecomposition * lu) const
+{
+  if (sparseLu)
+    sparseLu->Solve(x->Data(), x->GetLeadingDimension(), x->GetWidth(), &pool);
+  else if (lu->IsInvertible())
+    lu->Solve(x->Data(), x->GetLeadingDimension(), x->GetWidth(), &pool);
+  else
   {
-    Matrix * sparse = new SparseMatrix(x, y);
-    for (int i = 0; i < x; ++i)
+    delete x;
+    std::__throw_invalid_argument("Matrix isn't invertible!");
+  }
+  return x;
+}
+
+Matrix * Calculator::Solve(const Matrix& a, const Matrix& b) const
+{
+  CheckSystem(a, b);
+  DenseMatrix * x = new DenseMatrix(b.GetWidth(), b.GetHeight());
+  b.CopyTo(x->Data(), x->GetLeadingDimension());
+  if (typeid(SparseMatrix) == typeid(a))
+  {
+    SparseLU sparseLu(static_cast<const SparseMatrix&>(a));
+    if (sparseLu.IsFactorized())
+      return Solve(x, &sparseLu, nullptr);
+  }
+  LUDecomposition lu(a, LUDecomposition::PARTIAL, &pool);
+  return Solve(x, nullptr, &lu);
+}
+
+Matrix * Calculator::Solve(const std::string& a, const std::string& b) const
+{
+  const Variable& variable = matricies.at(a);
+  const Matrix& rhs = *matricies.at(b).matrix;
+  CheckSystem(*variable.matrix, rhs);
+  const SparseLU * sparseLu = SparseFactorization(variable);
+  DenseMatrix * x = new DenseMatrix(rhs.GetWidth(), rhs.GetHeight());
+  rhs.CopyTo(x->Data(), x->GetLeadingDimension());
+  if (sparseLu)
+    return Solve(x, sparseLu, nullptr);
+  return Solve(x, nullptr, &Factorization(variable));
+}
+
+Matrix * Calculator::SolveIterative(const std::string& a, const std::string& b,
+                                    const IterativeSolver::Settings& settings, IterativeSolver::Result& result) const
+{
+  const Matrix& m = *matricies.at(a).matrix;
+  const Matrix& rhs = *matricies.at(b).matrix;
+  CheckSystem(m, rhs);
+  SparseMatrix * temp = nullptr;
+  const SparseMatrix& sparse = ToSparse(m, temp);
+  std::unique_ptr<SparseMatrix> owner(temp);
+  IterativeSolver solver(sparse, settings, &pool);
+  DenseMatrix * x = new DenseMatrix(rhs.GetWidth(), rhs.GetHeight());
+  double * column = arena.Allocate<double>(rhs.GetHeight());
+  result = {0, 0, true};
+  for (int i = 0; i < rhs.GetWidth(); ++i)
+  {
+    rhs.CopyColumnTo(i, column);
+    IterativeSolver::Result columnResult = solver.Solve(column, x->Column(i));
+    result.iterations = std::max(result.iterations, columnResult.iterations);
+    result.residual = std::max(result.residual, columnResult.residual);
+    result.converged = result.converged && columnResult.converged;
+  }
+  return x;
+}
+
+Matrix * Calculator::Evaluate(const Expression& expression) const
+{
+  std::vector<Term> terms;
+  std::vector<std::unique_ptr<Matrix>> temporaries;
+  Collect(expression, 1, terms, temporaries);
+  // Single product is already the result, single variable is copied
+  if (terms.size() == 1 && terms[0].coefficient == 1)
+  {
+    if (!temporaries.empty())
+      return temporaries.back().release();
+    return terms[0].matrix->GetCopy();
+  }
+  Matrix * result = LinearCombination(terms);
+  if (result == nullptr)
+    std::__throw_invalid_argument("Dimensions don't match!");
+  return result;
+}
+
+double Calculator::EvaluateScalar(const Expression& expression) const
+{
+  switch (expression.GetType())
+  {
+    case Expression::NUMBER:
+      return expression.GetNumber();
+    case Expression::NEGATE:
+      return -EvaluateScalar(*expression.GetLeft());
+    case Expression::ADD:
+      return EvaluateScalar(*expression.GetLeft()) + EvaluateScalar(*expression.GetRight());
+    case Expression::SUBTRACT:
+      return EvaluateScalar(*expression.GetLeft()) - EvaluateScalar(*expression.GetRight());
+    case Expression::MULTIPLY:
+      return EvaluateScalar(*expression.GetLeft()) * EvaluateScalar(*expression.GetRight());
+    default:
+      std::__throw_invalid_argument("Not a number!");
+  }
+}
+
+void Calculator::Collect(const Expression& expression, double coefficient, std::vector<Term>& terms,
+                         std::vector<std::unique_ptr<Matrix>>& temporaries) const
+{
+  if (expression.IsScalar())
+    std::__throw_invalid_argument("Can't add number and matrix!");
+  const Expression * left = expression.GetLeft();
+  const Expression * right = expression.GetRight();
+  switch (expression.GetType())
+  {
+    case Expression::VARIABLE:
     {
-      for (int j = 0; j < y; ++j)
+      const Matrix * m = GetVariable(expression.GetName());
+      if (m == nullptr)
+        std::__throw_invalid_argument("Variable not used!");
+      terms.push_back({coefficient, m});
+      break;
+    }
+    case Expression::NEGATE:
+      Collect(*left, -coefficient, terms, temporaries);
+      break;
+    case Expression::ADD:
+      Collect(*left, coefficient, terms, temporaries);
+      Collect(*right, coefficient, terms, temporaries);
+      break;
+    case Expression::SUBTRACT:
+      Collect(*left, coefficient, terms, temporaries);
+      Collect(*right, -coefficient, terms, temporaries);
+      break;
+    case Expression::MULTIPLY:
+    {
+      if (left->IsScalar())
+      {
+        Collect(*right, coefficient * EvaluateScalar(*left), terms, temporaries);
+        break;
+      }
+      if (right->IsScalar())
       {
-        double val = splitted->At(i, j);
-        if (val != 0)
-          sparse->SetAt(i, j, val);
+        Collect(*left, coefficient * EvaluateScalar(*right), terms, temporaries);
+        break;
       }
+      std::vector<const Matrix *> factors;
+      GatherFactors(expression, coefficient, factors, temporaries);
+      Matrix * product = MultiplyChain(factors);
+      if (product == nullptr)
+        std::__throw_invalid_argument("Dimensions don't match!");
+      temporaries.emplace_back(product);
+      terms.push_back({coefficient, product});
+      break;
     }
-    delete splitted;
-    return sparse;
+    default:
+      break;
   }
-  else
-    return splitted;
 }
 
-Matrix * Calculator::Add(const Matrix& m1, const Matrix& m2) const
+void Calculator::GatherFactors(const Expression& expression, double& coefficient,
+                               std::vector<const Matrix *>& factors,
+                               std::vector<std::unique_ptr<Matrix>>& temporaries) const
 {
-  if (m1.GetWidth() != m2.GetWidth() || m1.GetHeight() != m2.GetHeight())
-    return nullptr;
-  Matrix * result;
-  if (typeid(SparseMatrix) == typeid(m1) && typeid(SparseMatrix) == typeid(m2))
-    result = new SparseMatrix(m1.GetWidth(), m1.GetHeight());
+  if (expression.GetType() != Expression::MULTIPLY)
+  {
+    std::unique_ptr<Matrix> temp;
+    factors.push_back(&Operand(expression, temp));
+    if (temp)
+      temporaries.push_back(std::move(temp));
+    return;
+  }
+  const Expression * left = expression.GetLeft();
+  const Expression * right = expression.GetRight();
+  if (left->IsScalar())
+    coefficient *= EvaluateScalar(*left);
   else
-    result = new DenseMatrix(m1.GetWidth(), m1.GetHeight());
-  for (int x = 0; x < m1.GetWidth(); ++x)
-    for (int y = 0; y < m1.GetHeight(); ++y)
-      result->SetAt(x, y, m1.At(x, y) + m2.At(x, y));
-  return result;
+    GatherFactors(*left, coefficient, factors, temporaries);
+  if (right->IsScalar())
+    coefficient *= EvaluateScalar(*right);
+  else
+    GatherFactors(*right, coefficient, factors, temporaries);
 }
 
-Matrix * Calculator::Multiply(const Matrix& m1, const Matrix& m2) const
+const Matrix& Calculator::Operand(const Expression& expression, std::unique_ptr<Matrix>& temp) const
 {
-  if (m2.GetHeight() != m1.GetWidth())
-    return nullptr;
-  Matrix * result;
-  if (typeid(SparseMatrix) == typeid(m1) && typeid(SparseMatrix) == typeid(m2))
-    result = new SparseMatrix(m2.GetWidth(), m1.GetHeight());
+  if (expression.GetType() == Expression::VARIABLE)
+  {
+    const Matrix * m = GetVariable(expression.GetName());
+    if (m == nullptr)
+      std::__throw_invalid_argument("Variable not used!");
+    return *m;
+  }
+  temp.reset(Evaluate(expression));
+  return *temp;
+}
+
+void Calculator::AddScaled(double * __restrict column, double a, const double * __restrict x, int height)
+{
+  // unrolled, so that g++ -O2 turns it into packed multiply-adds
+  int y = 0;
+  for (; y + 4 <= height; y += 4)
+  {
+    column[y] += a * x[y];
+    column[y + 1] += a * x[y + 1];
+    column[y + 2] += a * x[y + 2];
+    column[y + 3] += a * x[y + 3];
+  }
+  for (; y < height; ++y)
+    column[y] += a * x[y];
+}
+
+void Calculator::AddScaled(double * __restrict column, double a, const double * __restrict x, double b,
+                           const double * __restrict z, int height)
+{
+  int y = 0;
+  for (; y + 4 <= height; y += 4)
+  {
+    column[y] += a * x[y] + b * z[y];
+    column[y + 1] += a * x[y + 1] + b * z[y + 1];
+    column[y + 2] += a * x[y + 2] + b * z[y + 2];
+    column[y + 3] += a * x[y + 3] + b * z[y + 3];
+  }
+  for (; y < height; ++y)
+    column[y] += a * x[y] + b * z[y];
+}
+
+Matrix * Calculator::CombineSparse(const std::vector<Term>& terms) const
+{
+  int width = terms[0].matrix->GetWidth();
+  int height = terms[0].matrix->GetHeight();
+  std::vector<int> rowPtr(height + 1, 0);
+  std::vector<int> colIdx;
+  std::vector<double> values;
+  long long capacity = 0;
+  for (const Term& term:terms)
+    capacity += term.matrix->GetNonZeroCount();
+  capacity = std::min(capacity, (long long) width * height);
+  colIdx.reserve(capacity);
+  values.reserve(capacity);
+  auto push = [&](int x, double val)
+  {
+    if (val != 0)
+    {
+      colIdx.push_back(x);
+      values.push_back(val);
+    }
+  };
+  if (terms.size() == 2)
+  {
+    // Sorted rows of both terms are merged
+    const SparseMatrix& s1 = static_cast<const SparseMatrix&>(*terms[0].matrix);
+    const SparseMatrix& s2 = static_cast<const SparseMatrix&>(*terms[1].matrix);
+    double c1 = terms[0].coefficient;
+    double c2 = terms[1].coefficient;
+    for (int y = 0; y < height; ++y)
+    {
+      SparseMatrix::RowSpan r1 = s1.GetRowSpan(y);
+      SparseMatrix::RowSpan r2 = s2.GetRowSpan(y);
+      int i = 0, j = 0;
+      while (i < r1.size && j < r2.size)
+      {
+        if (r1.index[i] < r2.index[j])
+        {
+          push(r1.index[i], c1 * r1.values[i]);
+          i++;
+        }
+        else if (r2.index[j] < r1.index[i])
+        {
+          push(r2.index[j], c2 * r2.values[j]);
+          j++;
+        }
+        else
+        {
+          push(r1.index[i], c1 * r1.values[i] + c2 * r2.values[j]);
+          i++;
+          j++;
+        }
+      }
+      for (; i < r1.size; ++i)
+        push(r1.index[i], c1 * r1.values[i]);
+      for (; j < r2.size; ++j)
+        push(r2.index[j], c2 * r2.values[j]);
+      rowPtr[y + 1] = values.size();
+    }
+  }
   else
-    result = new DenseMatrix(m2.GetWidth(), m1.GetHeight());
-  for (int x = 0; x < result->GetWidth(); ++x)
   {
-    for (int y = 0; y < result->GetHeight(); ++y)
+    // Row y of every term is scattered to acc, touched lists its columns
+    int * marker = arena.Allocate<int>(width);
+    double * acc = arena.Allocate<double>(width);
+    int * touched = arena.Allocate<int>(width);
+    int touchedCount = 0;
+    std::fill(marker, marker + width, -1);
+    for (int y = 0; y < height; ++y)
     {
-      double val = 0;
-      for (int i = 0; i < m1.GetWidth(); ++i)
-        val += m1.At(i, y) * m2.At(x, i);
-      result->SetAt(x, y, val);
+      for (const Term& term:terms)
+      {
+        SparseMatrix::RowSpan row = static_cast<const SparseMatrix *>(term.matrix)->GetRowSpan(y);
+        for (int i = 0; i < row.size; ++i)
+        {
+          int x = row.index[i];
+          if (marker[x] != y)
+          {
+            marker[x] = y;
+            acc[x] = term.coefficient * row.values[i];
+            touched[touchedCount++] = x;
+          }
+          else
+            acc[x] += term.coefficient * row.values[i];
+        }
+      }
+      std::sort(touched, touched + touchedCount);
+      for (int i = 0; i < touchedCount; ++i)
+        push(touched[i], acc[touched[i]]);
+      touchedCount = 0;
+      rowPtr[y + 1] = values.size();
     }
   }
-  return result;
+  return new SparseMatrix(width, height, std::move(rowPtr), std::move(colIdx), std::move(values));
 }
 
-Matrix * Calculator::Inverse(const Matrix& m) const
+Matrix * Calculator::LinearCombination(const std::vector<Term>& terms) const
 {
-  int size = m.GetWidth();
-  if (size != m.GetHeight())
-    std::__throw_invalid_argument("Not a square matrix!");
-  SparseMatrix identity(size, size);
-  for (int i = 0; i < size; ++i)
-    identity.SetAt(i, i, 1);
-  Matrix * extended = Merge(m, identity, 1);
-  Matrix * gemed = GEM(*extended);
-  delete extended;
-  for (int i = size - 1; i >= 0; --i)
-  {
-    double pivot = gemed->At(i, i);
-    if (pivot == 0)
+  if (terms.empty())
+    return nullptr;
+  int width = terms[0].matrix->GetWidth();
+  int height = terms[0].matrix->GetHeight();
+  bool sparse = true;
+  std::vector<Term> dense;
+  std::vector<const SparseMatrix *> sparseTerms;
+  std::vector<double> sparseCoefficients;
+  std::vector<std::unique_ptr<DenseMatrix>> converted;
+  for (const Term& term:terms)
+  {
+    if (!term.matrix->SameSize(*terms[0].matrix))
+      return nullptr;
+    if (typeid(SparseMatrix) == typeid(*term.matrix))
     {
-      delete gemed;
-      std::__throw_invalid_argument("Matrix isn't invertible!");
+      sparseTerms.push_back(static_cast<const SparseMatrix *>(term.matrix));
+      sparseCoefficients.push_back(term.coefficient);
+      continue;
     }
-    for (int y = i - 1; y >= 0; --y)
+    sparse = false;
+    if (typeid(DenseMatrix) == typeid(*term.matrix))
     {
-      double ratio = gemed->At(i, y) / pivot;
-      for (int x = 0; x < size * 2; ++x)
-        gemed->SetAt(x, y, gemed->At(x, i) * -ratio + gemed->At(x, y));
+      dense.push_back(term);
+      continue;
     }
-    for (int x = 0; x < size * 2; ++x)
-      gemed->SetAt(x, i, gemed->At(x, i) / pivot);
+    // other storage (BlockMatrix) is copied to one buffer first
+    DenseMatrix * temp = nullptr;
+    ToDense(*term.matrix, temp);
+    converted.emplace_back(temp);
+    dense.push_back({term.coefficient, temp});
   }
-  Matrix * splitted = Split(*gemed, size, 0, size, size);
-  delete gemed;
-  return splitted;
+  if (sparse)
+    return CombineSparse(terms);
+  // Every column of the result is finished at once: dense terms by pairs, then the sparse ones
+  DenseMatrix * result = new DenseMatrix(width, height);
+  for (int x = 0; x < width; ++x)
+  {
+    double * column = result->Column(x);
+    size_t i = 0;
+    for (; i + 1 < dense.size(); i += 2)
+      AddScaled(column, dense[i].coefficient, static_cast<const DenseMatrix *>(dense[i].matrix)->Column(x),
+                dense[i + 1].coefficient, static_cast<const DenseMatrix *>(dense[i + 1].matrix)->Column(x), height);
+    if (i < dense.size())
+      AddScaled(column, dense[i].coefficient, static_cast<const DenseMatrix *>(dense[i].matrix)->Column(x), height);
+    for (size_t j = 0; j < sparseTerms.size(); ++j)
+    {
+      const int * colPtr = sparseTerms[j]->GetColumnPointers();
+      const int * rowIdx = sparseTerms[j]->GetRowIndices();
+      const int * colPos = sparseTerms[j]->GetColumnPositions();
+      const double * values = sparseTerms[j]->GetValues();
+      double coefficient = sparseCoefficients[j];
+      for (int k = colPtr[x]; k < colPtr[x + 1]; ++k)
+        column[rowIdx[k]] += coefficient * values[colPos[k]];
+    }
+  }
+  return result;
+}
+
+void Calculator::SetThreads(int count)
+{
+  pool.Resize(count);
+}
+
+int Calculator::GetThreads() const
+{
+  return pool.GetThreadCount();
 }
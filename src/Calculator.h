@@ -8,15 +8,30 @@
 #define SEM_CALC
 
 #include <map>
+#include <memory>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 #include <locale>
 #include <vector>
 #include <typeinfo>
+#include <cmath>
 #include "Matrix.h"
 #include "SparseMatrix.h"
 #include "DenseMatrix.h"
+#include "BlockMatrix.h"
+#include "TripletBuilder.h"
+#include "Gemm.h"
+#include "SparseKernels.h"
+#include "ThreadPool.h"
+#include "LUDecomposition.h"
+#include "SparseLU.h"
+#include "IterativeSolver.h"
+#include "Expression.h"
+#include "MatrixFile.h"
+#include "MatrixText.h"
+#include "MatrixPrinter.h"
+#include "Arena.h"
 
 /**
 * @class    Calculator
@@ -25,19 +40,29 @@
 */
 class Calculator
 {
+public:
+  /**
+  * @struct   Term
+  * @brief    Matrix with its coefficient in a linear combination
+  */
+  struct Term
+  {
+    double coefficient;
+    const Matrix * matrix;
+  };
+
+private:
   std::ostream& os;
+  bool colors;
+  mutable MatrixPrinter printer;
+  mutable ThreadPool pool;
+  mutable Arena arena;
 
   enum COLORS
   {
     RED = 1, GREEN, YELLOW, BLUE, MAGENTA, CYAN
   };
 
-  /**
-  * @fn        DoubleLength
-  * @returns   Length of string of double
-  */
-  int DoubleLength(double num) const;
-
   /**
   * @fn        Abs
   * @returns   Absolute value of num
@@ -46,12 +71,12 @@ class Calculator
 
   /**
   * @fn        FindPivot
-  * @param     col - collum of matrix m
+  * @param     column - Contiguous collum of height elements
   * @param     startIndex - Takes into account only indexes from startIndex and onward
-  * @returns   Index in col of m, that has closet number to zero excluding zero
+  * @returns   Index in column, that has closet number to zero excluding zero
   * @returns   or -1 if no such number was found
   */
-  int FindPivot(const Matrix& m, int col, int startIndex) const;
+  int FindPivot(const double * column, int height, int startIndex) const;
 
   /**
   * @fn        OsSetColor
@@ -87,38 +112,205 @@ class Calculator
   */
   void OsReset() const;
 
+  /**
+  * @fn        Scratch
+  * @returns   Uninitialized width x height matrix in the arena
+  * @details   Its buffer is valid until ResetArena, so it mustn't be copied to a result or a variable.
+  */
+  DenseMatrix Scratch(int width, int height) const;
+
+  /**
+  * @fn        ToDense
+  * @returns   m itself, if it's DenseMatrix, or its dense copy in the arena, which is saved to temp
+  */
+  const DenseMatrix& ToDense(const Matrix& m, DenseMatrix *& temp) const;
+
+  /**
+  * @fn        ToSparse
+  * @returns   m itself, if it's SparseMatrix, or its sparse copy, which is saved to temp
+  */
+  const SparseMatrix& ToSparse(const Matrix& m, SparseMatrix *& temp) const;
+
+  /**
+  * @struct   Variable
+  * @brief    Matrix variable with its cached factorizations
+  * @details   lu is created on first use and deleted whenever the matrix changes.
+  * @details   sparseLu of square sparse variable is kept, when the new matrix has the same pattern,
+  * @details   and refactor marks, that only its numeric phase has to be repeated.
+  */
+  struct Variable
+  {
+    Matrix * matrix;
+    mutable LUDecomposition * lu;
+    mutable SparseLU * sparseLu;
+    mutable bool refactor;
+  };
+
+  std::map<std::string, Variable> matricies;
+
+  /**
+  * @fn        Factorization
+  * @returns   Cached LU factorization of the variable with partial pivoting, which is created if needed
+  */
+  const LUDecomposition& Factorization(const Variable& var) const;
+
+  /**
+  * @fn        Collect
+  * @brief     Flattens sums, differences, negations and multiples by numbers of the expression to terms
+  * @param     coefficient - Number, by which the whole expression is multiplied
+  * @param     temporaries - Owner of the matrix products, which are evaluated for their terms
+  */
+  void Collect(const Expression& expression, double coefficient, std::vector<Term>& terms,
+               std::vector<std::unique_ptr<Matrix>>& temporaries) const;
+
+  /**
+  * @fn        Operand
+  * @returns   Variable of the expression or its value, which is saved to temp
+  */
+  const Matrix& Operand(const Expression& expression, std::unique_ptr<Matrix>& temp) const;
+
+  /**
+  * @fn        GatherFactors
+  * @brief     Flattens a product of the expression to its matrix factors in order
+  * @param     coefficient - Multiplied by all the numbers in the product
+  * @param     temporaries - Owner of the factors, which had to be evaluated
+  */
+  void GatherFactors(const Expression& expression, double& coefficient, std::vector<const Matrix *>& factors,
+                     std::vector<std::unique_ptr<Matrix>>& temporaries) const;
+
+  /**
+  * @fn        ChainOrder
+  * @brief     Finds the cheapest order of multiplication of the factors by dynamic programming
+  * @details   Cost of a product is its number of multiply-adds and stored elements. Sparse factors count
+  * @details   by their density, density of a product of 2 sparse matricies is estimated as if
+  * @details   their nonzeros were spread uniformly.
+  * @returns   split[first * n + last] - Index of the last factor of the left part of product first .. last
+  */
+  std::vector<int> ChainOrder(const std::vector<const Matrix *>& factors) const;
+
+  /**
+  * @fn        MultiplyRange
+  * @brief     Multiplies factors first .. last in the order given by split
+  * @returns   The factor itself, if first == last, or the product, which is saved to temp
+  */
+  const Matrix& MultiplyRange(const std::vector<const Matrix *>& factors, const std::vector<int>& split,
+                              int first, int last, std::unique_ptr<Matrix>& temp) const;
+
+  /**
+  * @fn        AddScaled
+  * @brief     column += a * x (+ b * z) over height elements, the buffers mustn't overlap
+  */
+  static void AddScaled(double * __restrict column, double a, const double * __restrict x, int height);
+
+  static void AddScaled(double * __restrict column, double a, const double * __restrict x, double b,
+                        const double * __restrict z, int height);
+
+  /**
+  * @fn        CombineSparse
+  * @brief     Linear combination of sparse terms row by row, stored directly to CSR arrays
+  * @details   Rows of 2 terms are merged, more terms are scattered to a dense row first.
+  * @returns   Pointer to the new matrix
+  */
+  Matrix * CombineSparse(const std::vector<Term>& terms) const;
+
+  /**
+  * @fn        SparseFactorization
+  * @returns   Cached sparse factorization of square sparse variable or nullptr, if the variable
+  * @returns   isn't such or its factorization broke down
+  */
+  const SparseLU * SparseFactorization(const Variable& var) const;
+
+  /**
+  * @fn        CheckSystem
+  * @brief     Throws std::invalid_argument, if A * X = B can't be solved for its dimensions
+  */
+  void CheckSystem(const Matrix& a, const Matrix& b) const;
+
+  /**
+  * @fn        Solve
+  * @brief     Overwrites x by solution of A * X = x with sparseLu of A, if it isn't nullptr, or with lu
+  * @details   x is deleted, if A isn't invertible.
+  * @returns   x
+  */
+  Matrix * Solve(DenseMatrix * x, const SparseLU * sparseLu, const LUDecomposition * lu) const;
+
 public:
-  std::map<std::string, Matrix *> matricies;
 
-  Calculator(std::ostream& os = std::cout);
+  /**
+  * @param     colors - Highlight the output by ANSI escape codes, false for plain text
+  */
+  Calculator(std::ostream& os = std::cout, bool colors = true);
+
+  /**
+  * @fn        ResetArena
+  * @brief     Releases scratch buffers of the finished command at once
+  * @details   Called after every command, when none of its temporaries is alive.
+  */
+  void ResetArena();
 
   /**
   * @fn        GEM
   * @brief     Gauss-elimination method
   * @param     commentary - True to comment the steps
+  * @details   Without commentary the same steps are done by blocked LUDecomposition with GEM pivoting.
   * @returns   Pointer to gauss-eliminated matrix
   */
   Matrix * GEM(const Matrix& m, bool commentary) const;
 
+  /**
+  * @fn        GetVariable
+  * @returns   Matrix saved in variable or nullptr, if there isn't such variable
+  */
+  Matrix * GetVariable(const std::string& var) const;
+
+  /**
+  * @fn        SetVariable
+  * @brief     Saves the matrix to variable, the variable's previous matrix is deleted
+  * @details   Calculator takes ownership of m.
+  */
+  void SetVariable(const std::string& var, Matrix * m);
+
+  /**
+  * @fn        TransposeVariable
+  * @brief     Transposes the matrix saved in variable
+  */
+  void TransposeVariable(const std::string& var);
+
   /**
   * @fn        Rank
-  * @details   Gems the matrix and then counts number of pivots
+  * @details   Factorizes the matrix by blocked LU with partial pivoting and counts its pivots
   * @returns   Rank of a matrix
   */
   int Rank(const Matrix& m) const;
 
+  /**
+  * @fn        Rank
+  * @details   Uses cached factorization of the variable
+  * @returns   Rank of a variable
+  */
+  int Rank(const std::string& var) const;
+
   /**
   * @fn        Determinant
-  * @details   Gems the matrix and multiplies its diagonal
+  * @details   Factorizes the matrix by blocked LU with partial pivoting and multiplies diagonal of U
   * @returns   Determinant of a matrix
   */
   double Determinant(const Matrix& m) const;
 
+  /**
+  * @fn        Determinant
+  * @details   Uses cached factorization of the variable
+  * @returns   Determinant of a variable
+  */
+  double Determinant(const std::string& var) const;
+
   /**
   * @fn        PrintVariable
   * @brief     Prints the variable from matricies to os
+  * @param     mode - Summarized over the print limit, whole or list of nonzero elements (see MatrixPrinter)
+  * @returns   False, if the variable isn't declared
   */
-  void PrintVariable(const std::string& var) const;
+  bool PrintVariable(const std::string& var, MatrixPrinter::Mode mode = MatrixPrinter::AUTO) const;
 
   /**
   * @fn        PrintMatrix
@@ -127,15 +319,37 @@ public:
   * @param     colors - matrix that encodes color values
   * @details   Optional color matrix may be provided to print the matrix in color.
   * @details   Double to color is used to convert the values of color matrix to color
+  * @details   Matrix without colors is printed by MatrixPrinter, which summarizes it over the print limit.
   */
   void PrintMatrix(Matrix * m, Matrix * colors = nullptr) const;
 
+  /**
+  * @fn        SetPrintLimit
+  * @brief     Matricies with more rows or columns than limit are printed summarized
+  * @param     limit - 0 for no limit
+  * @param     edge - Rows or columns shown from each side of a summarized matrix
+  */
+  void SetPrintLimit(int limit, int edge);
+
+  /**
+  * @fn        GetPrintLimit
+  * @returns   Largest number of rows or columns printed whole, 0 for no limit
+  */
+  int GetPrintLimit() const;
+
+  /**
+  * @fn        GetPrintEdge
+  * @returns   Rows or columns shown from each side of a summarized matrix
+  */
+  int GetPrintEdge() const;
+
   /**
   * @fn        Merge
   * @brief     Merges 2 matricies together
   * @param     direction == 1 - Horizontally
   * @param     direction == 2 - Vertically, anything else and the calculator will try to figure it out
   * for itself, preferring the horizontal direction
+  * @details   Result is a BlockMatrix, which shares the storage of m1 and m2, nothing is copied.
   */
   Matrix * Merge(const Matrix& m1, const Matrix& m2, int direction = 0) const;
 
@@ -146,6 +360,8 @@ public:
   * @param     width, height - Dimensions of the submatrix
   * @returns   Either the submatrix pointer or nullptr, if the dimensions of the submatrix
   * @returns   are outside the area of the original matrix
+  * @details   Submatrix of DenseMatrix is a view, which shares its buffer, until one of them is modified.
+  * @details   Nonzeros of SparseMatrix in the area are copied, rows outside of it aren't visited.
   */
   Matrix * Split(const Matrix& m, int x, int y, int width, int height) const;
 
@@ -156,6 +372,29 @@ public:
   */
   Matrix * Add(const Matrix& m1, const Matrix& m2) const;
 
+  /**
+  * @fn        Subtract
+  * @brief     Subtracts m2 from m1 in one pass
+  * @returns   Pointer to the new matrix or nullptr, if the dimensions don't match
+  */
+  Matrix * Subtract(const Matrix& m1, const Matrix& m2) const;
+
+  /**
+  * @fn        Axpy
+  * @brief     Computes alpha * x + beta * y in one pass
+  * @returns   Pointer to the new matrix or nullptr, if the dimensions don't match
+  */
+  Matrix * Axpy(double alpha, const Matrix& x, double beta, const Matrix& y) const;
+
+  /**
+  * @fn        LinearCombination
+  * @brief     Computes sum of coefficient * matrix of all the terms in one pass over the result
+  * @details   Result is sparse, if all the terms are sparse, and dense otherwise. Dense result
+  * @details   is computed column by column, sparse row by row straight into CSR arrays.
+  * @returns   Pointer to the new matrix or nullptr, if there are no terms or the dimensions don't match
+  */
+  Matrix * LinearCombination(const std::vector<Term>& terms) const;
+
   /**
   * @fn        Multiply
   * @brief     Multiply 2 matricies together
@@ -163,13 +402,119 @@ public:
   */
   Matrix * Multiply(const Matrix& m1, const Matrix& m2) const;
 
+  /**
+  * @fn        MultiplyChain
+  * @brief     Multiplies all the factors together in the cheapest order
+  * @details   Intermediate products are deleted as soon as they are used, so for example
+  * @details   (tall * wide) * vector is computed as tall * (wide * vector).
+  * @returns   Pointer to the new matrix or nullptr, if there are no factors or the dimensions don't match
+  */
+  Matrix * MultiplyChain(const std::vector<const Matrix *>& factors) const;
+
   /**
   * @fn        Inverse
   * @brief     Creates an inverse matrix of square matrix
+  * @details   Factorizes the matrix by blocked LU with partial pivoting (SparseLU, if it's sparse)
+  * @details   and solves for the identity.
   * @returns   Pointer to the new matrix
   */
   Matrix * Inverse(const Matrix& m) const;
 
+  /**
+  * @fn        Inverse
+  * @brief     Creates an inverse matrix of square variable using its cached factorization
+  * @returns   Pointer to the new matrix
+  */
+  Matrix * Inverse(const std::string& var) const;
+
+  /**
+  * @fn        Save
+  * @brief     Writes variable to the binary file at path (see MatrixFile)
+  * @details   Throws std::invalid_argument, if the file can't be written.
+  */
+  void Save(const std::string& var, const std::string& path) const;
+
+  /**
+  * @fn        Load
+  * @brief     Reads a matrix from the binary file at path
+  * @param     verify - Check the whole file against its checksum
+  * @details   Dense matrix is mapped to memory, so loading it doesn't depend on its size.
+  * @details   Throws std::invalid_argument, if the file is missing or damaged.
+  * @returns   Pointer to the new matrix
+  */
+  Matrix * Load(const std::string& path, bool verify) const;
+
+  /**
+  * @fn        Export
+  * @brief     Writes variable to Matrix Market (.mtx) or CSV file at path (see MatrixText)
+  * @details   Throws std::invalid_argument, if the file can't be written.
+  */
+  void Export(const std::string& var, const std::string& path) const;
+
+  /**
+  * @fn        Import
+  * @brief     Reads a matrix from Matrix Market or CSV file at path
+  * @details   Throws std::invalid_argument, if the file is missing or malformed.
+  * @returns   Pointer to the new matrix
+  */
+  Matrix * Import(const std::string& path) const;
+
+  /**
+  * @fn        Solve
+  * @brief     Solves A * X = B for square matrix A
+  * @param     b - Right-hand sides, one in every column
+  * @returns   Pointer to the new matrix X
+  * @details   A is factorized once and every column is solved by substitution, the inverse isn't formed.
+  */
+  Matrix * Solve(const Matrix& a, const Matrix& b) const;
+
+  /**
+  * @fn        Solve
+  * @brief     Solves A * X = B for square variable A using its cached factorization
+  * @returns   Pointer to the new matrix X
+  */
+  Matrix * Solve(const std::string& a, const std::string& b) const;
+
+  /**
+  * @fn        SolveIterative
+  * @brief     Solves A * X = B for square variable A by a Krylov subspace method
+  * @param     result - Largest number of iterations and residual among the columns of B
+  * @returns   Pointer to the new matrix X
+  * @details   Dense A is converted to sparse first. Columns of B are solved one by one from zero.
+  */
+  Matrix * SolveIterative(const std::string& a, const std::string& b, const IterativeSolver::Settings& settings,
+                          IterativeSolver::Result& result) const;
+
+  /**
+  * @fn        Evaluate
+  * @brief     Evaluates expression, whose value is a matrix
+  * @details   Sums, differences and multiples are evaluated together as one linear combination
+  * @details   of variables and products, so no temporary is created for them. Every product
+  * @details   of more matricies is computed by MultiplyChain.
+  * @details   Throws std::invalid_argument, if the dimensions don't match or a number is added to a matrix.
+  * @returns   Pointer to the new matrix
+  */
+  Matrix * Evaluate(const Expression& expression) const;
+
+  /**
+  * @fn        EvaluateScalar
+  * @returns   Value of expression without variables
+  */
+  double EvaluateScalar(const Expression& expression) const;
+
+  /**
+  * @fn        SetThreads
+  * @brief     Sets the number of threads used by the operations
+  * @param     count - Number of threads, 0 for number of cores
+  */
+  void SetThreads(int count);
+
+  /**
+  * @fn        GetThreads
+  * @returns   Number of threads used by the operations
+  */
+  int GetThreads() const;
+
   ~Calculator();
 };
 
@@ -1,59 +1,314 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
 #include "DenseMatrix.h"
 
+const int TRANSPOSEBLOCK = 32;
+
+double * DenseMatrix::Allocate(int width, int ld)
+{
+  size_t size = (size_t) width * ld * sizeof(double);
+  void * buffer = nullptr;
+  if (posix_memalign(&buffer, ALIGNMENT, size) != 0)
+    throw std::bad_alloc();
+  std::memset(buffer, 0, size);
+  return static_cast<double *>(buffer);
+}
+
+int DenseMatrix::LeadingDimension(int height)
+{
+  const int perLine = ALIGNMENT / sizeof(double);
+  return (height + perLine - 1) / perLine * perLine;
+}
+
+void DenseMatrix::TransposeBuffer(const double * source, int sourceLd, int columns, int height, double * dest,
+                                  int destLd)
+{
+  for (int xb = 0; xb < columns; xb += TRANSPOSEBLOCK)
+  {
+    int xEnd = std::min(xb + TRANSPOSEBLOCK, columns);
+    for (int yb = 0; yb < height; yb += TRANSPOSEBLOCK)
+    {
+      int yEnd = std::min(yb + TRANSPOSEBLOCK, height);
+      for (int x = xb; x < xEnd; ++x)
+      {
+        const double * column = source + (size_t) x * sourceLd;
+        for (int y = yb; y < yEnd; ++y)
+          dest[(size_t) y * destLd + x] = column[y];
+      }
+    }
+  }
+}
+
 double DenseMatrix::At(int x, int y) const
 {
-  return data[x][y];
+  if (transposed)
+    return data[(size_t) y * ld + x];
+  return data[(size_t) x * ld + y];
 }
 
 void DenseMatrix::SetAt(int x, int y, double val)
 {
-  data[x][y] = val;
+  Detach();
+  if (transposed)
+    data[(size_t) y * ld + x] = val;
+  else
+    data[(size_t) x * ld + y] = val;
+}
+
+DenseMatrix::DenseMatrix(int width, int height) : Matrix(width, height), ld(LeadingDimension(height)),
+                                                  transposed(false)
+{
+  data = Allocate(width, ld);
+  storage.reset(data, free);
+}
+
+DenseMatrix::DenseMatrix(const DenseMatrix& parent, int x, int y, int width, int height)
+    : Matrix(width, height), storage(parent.storage), ld(parent.ld), transposed(parent.transposed)
+{
+  if (transposed)
+    data = parent.data + (size_t) y * ld + x;
+  else
+    data = parent.data + (size_t) x * ld + y;
+}
+
+DenseMatrix::DenseMatrix(int width, int height, std::shared_ptr<double> buffer, int ld)
+    : Matrix(width, height), storage(std::move(buffer)), data(storage.get()), ld(ld), transposed(false)
+{
+  if (ld < height)
+    throw std::exception();
+}
+
+void DenseMatrix::Detach()
+{
+  if (!IsShared())
+    return;
+  // columns are copied one by one, the buffer may be a view with longer columns
+  int columns = transposed ? height : width;
+  int length = transposed ? width : height;
+  int newLd = LeadingDimension(length);
+  double * copy = Allocate(columns, newLd);
+  for (int x = 0; x < columns; ++x)
+    std::memcpy(copy + (size_t) x * newLd, data + (size_t) x * ld, length * sizeof(double));
+  storage.reset(copy, free);
+  data = copy;
+  ld = newLd;
+}
+
+void DenseMatrix::Materialize() const
+{
+  if (!transposed)
+    return;
+  // the buffer is width x height here, its columns are the rows of the matrix
+  int newLd = LeadingDimension(height);
+  double * copy = Allocate(width, newLd);
+  TransposeBuffer(data, ld, height, width, copy, newLd);
+  storage.reset(copy, free);
+  data = copy;
+  ld = newLd;
+  transposed = false;
+}
+
+bool DenseMatrix::IsShared() const
+{
+  return storage.use_count() > 1;
+}
+
+bool DenseMatrix::IsTransposed() const
+{
+  return transposed;
+}
+
+const double * DenseMatrix::GetLayout(int& ld, bool& transposed) const
+{
+  ld = this->ld;
+  transposed = this->transposed;
+  return data;
+}
+
+Matrix * DenseMatrix::GetCopy() const
+{
+  return new DenseMatrix(*this);
+}
+
+void DenseMatrix::Transpose()
+{
+  transposed = !transposed;
+  int num = width;
+  width = height;
+  height = num;
+}
+
+int DenseMatrix::GetLeadingDimension() const
+{
+  Materialize();
+  return ld;
+}
+
+double * DenseMatrix::Data()
+{
+  Materialize();
+  Detach();
+  return data;
 }
 
-DenseMatrix::DenseMatrix(int width, int height) : Matrix(width, height)
+const double * DenseMatrix::Data() const
 {
-  data = new double * [width];
+  Materialize();
+  return data;
+}
+
+double * DenseMatrix::Column(int x)
+{
+  double * first = Data();
+  return first + (size_t) x * ld;
+}
+
+const double * DenseMatrix::Column(int x) const
+{
+  const double * first = Data();
+  return first + (size_t) x * ld;
+}
+
+double * DenseMatrix::Row(int y)
+{
+  return Data() + y;
+}
+
+const double * DenseMatrix::Row(int y) const
+{
+  return Data() + y;
+}
+
+Matrix::Span DenseMatrix::GetColumnSpan(int x)
+{
+  Detach();
+  if (transposed)
+    return {data + x, height, ld};
+  return {data + (size_t) x * ld, height, 1};
+}
+
+Matrix::ConstSpan DenseMatrix::GetColumnSpan(int x) const
+{
+  if (transposed)
+    return {data + x, height, ld};
+  return {data + (size_t) x * ld, height, 1};
+}
+
+Matrix::Span DenseMatrix::GetRowSpan(int y)
+{
+  Detach();
+  if (transposed)
+    return {data + (size_t) y * ld, width, 1};
+  return {data + y, width, ld};
+}
+
+Matrix::ConstSpan DenseMatrix::GetRowSpan(int y) const
+{
+  if (transposed)
+    return {data + (size_t) y * ld, width, 1};
+  return {data + y, width, ld};
+}
+
+void DenseMatrix::SwapRows(int row1, int row2)
+{
+  if (row1 >= height || row2 >= height || row1 < 0 || row2 < 0)
+    throw std::exception();
+  Span first = GetRowSpan(row1);
+  Span second = GetRowSpan(row2);
   for (int i = 0; i < width; ++i)
   {
-    data[i] = new double[height];
-    for (int j = 0; j < height; ++j)
-      data[i][j] = 0;
+    double num = first[i];
+    first[i] = second[i];
+    second[i] = num != 0 ? -num : 0;
   }
 }
 
-DenseMatrix::~DenseMatrix()
+void DenseMatrix::ScalarMul(double num)
 {
-  for (int i = 0; i < width; ++i)
-    delete[] data[i];
-  delete[] data;
+  Detach();
+  int columns = transposed ? height : width;
+  int length = transposed ? width : height;
+  for (int x = 0; x < columns; ++x)
+  {
+    double * column = data + (size_t) x * ld;
+    for (int y = 0; y < length; ++y)
+      column[y] *= num;
+  }
 }
 
-Matrix * DenseMatrix::GetCopy() const
+void DenseMatrix::CopyTo(double * buffer, int ld) const
 {
-  Matrix * copy = new DenseMatrix(width, height);
-  for (int y = 0; y < height; ++y)
+  if (transposed)
   {
-    for (int x = 0; x < width; ++x)
-      copy->SetAt(x, y, At(x, y));
+    TransposeBuffer(data, this->ld, height, width, buffer, ld);
+    return;
   }
-  return copy;
+  for (int x = 0; x < width; ++x)
+    std::memcpy(buffer + (size_t) x * ld, data + (size_t) x * this->ld, height * sizeof(double));
 }
 
-void DenseMatrix::Transpose()
+void DenseMatrix::FillFrom(const double * buffer, int ld)
 {
-  double ** transposed;
-  transposed = new double * [height];
-  for (int i = 0; i < height; ++i)
+  // the old contents are overwritten, so a shared or transposed buffer isn't copied
+  if (IsShared() || transposed)
   {
-    transposed[i] = new double[width];
-    for (int j = 0; j < width; ++j)
-      transposed[i][j] = At(j, i);
+    this->ld = LeadingDimension(height);
+    data = Allocate(width, this->ld);
+    storage.reset(data, free);
+    transposed = false;
   }
-  for (int i = 0; i < width; ++i)
-    delete[] data[i];
-  delete[] data;
-  data = transposed;
-  int num = width;
-  width = height;
-  height = num;
+  for (int x = 0; x < width; ++x)
+    std::memcpy(data + (size_t) x * this->ld, buffer + (size_t) x * ld, height * sizeof(double));
+}
+
+void DenseMatrix::CopyRowTo(int y, double * buffer) const
+{
+  ConstSpan row = GetRowSpan(y);
+  if (row.stride == 1)
+  {
+    std::memcpy(buffer, row.data, width * sizeof(double));
+    return;
+  }
+  for (int x = 0; x < width; ++x)
+    buffer[x] = row[x];
+}
+
+void DenseMatrix::CopyColumnTo(int x, double * buffer) const
+{
+  ConstSpan column = GetColumnSpan(x);
+  if (column.stride == 1)
+  {
+    std::memcpy(buffer, column.data, height * sizeof(double));
+    return;
+  }
+  for (int y = 0; y < height; ++y)
+    buffer[y] = column[y];
+}
+
+long long DenseMatrix::ReadNonZeros(long long cursor, Entry * out, int max, int& count) const
+{
+  // the buffer is read in its own order, elements of transposed one are swapped back
+  int columns = transposed ? height : width;
+  int length = transposed ? width : height;
+  long long size = (long long) columns * length;
+  count = 0;
+  int x = cursor / length;
+  int y = cursor % length;
+  while (x < columns && count < max)
+  {
+    const double * column = data + (size_t) x * ld;
+    for (; y < length && count < max; ++y)
+      if (column[y] != 0)
+        out[count++] = transposed ? Entry{y, x, column[y]} : Entry{x, y, column[y]};
+    if (y == length)
+    {
+      y = 0;
+      x++;
+    }
+  }
+  cursor = (long long) x * length + y;
+  return cursor < size ? cursor : -1;
 }
@@ -7,19 +7,114 @@
 #ifndef SEM_DENSEMATRIX_H
 #define SEM_DENSEMATRIX_H
 
+#include <memory>
 #include "Matrix.h"
 
 /**
 * @class    DenseMatrix
 * @brief    Efficient storage for dense matricies
-* @details  Faster but bigger than SparseMatrix. Uses 2D array to store data.
+* @details  Faster but bigger than SparseMatrix. Uses one contiguous buffer to store data.
+* @details  The buffer is column-major and 64-byte aligned: element (x, y) lives at
+* @details  data[x * ld + y], where the leading dimension ld is height rounded up to
+* @details  a multiple of 8 doubles, so that every column starts on a cache line.
+* @details  The padding at the end of each column is kept zeroed, except in views of a block of another
+* @details  matrix, whose columns point into the buffer of the other matrix with its leading dimension.
+* @details  Copies share the buffer (copy-on-write): GetCopy and the copy constructor are O(1) and the
+* @details  buffer is duplicated by the first modification of a matrix, which doesn't own it alone.
+* @details  Every non-const accessor counts as a modification, so pointers it returns stay valid
+* @details  and private to the matrix, until the matrix is copied.
+* @details  Transpose only marks the buffer as holding the transposed matrix column by column (its rows).
+* @details  Element access, bulk copies, spans, SwapRows and ScalarMul work on such layout directly,
+* @details  GetLayout exposes it to kernels, which can read it (Gemm). Raw accessors Data, Column, Row
+* @details  and GetLeadingDimension first transpose the buffer physically in cache-sized blocks,
+* @details  which is the only place the layout is changed, so even const access may replace the buffer.
 */
 class DenseMatrix : public Matrix
 {
-  double ** data;
+  mutable std::shared_ptr<double> storage;
+  mutable double * data;
+  mutable int ld;
+  mutable bool transposed;
+
+  /**
+  * @fn        Allocate
+  * @brief     Allocates a zeroed, aligned buffer for width columns of ld doubles
+  */
+  static double * Allocate(int width, int ld);
+
+  /**
+  * @fn        TransposeBuffer
+  * @brief     Writes transposed columns x height column-major source to column-major dest in blocks
+  */
+  static void TransposeBuffer(const double * source, int sourceLd, int columns, int height, double * dest,
+                              int destLd);
+
+  /**
+  * @fn        Detach
+  * @brief     Makes a private copy of the buffer, if it's shared with another matrix
+  */
+  void Detach();
+
+  /**
+  * @fn        Materialize
+  * @brief     Transposes the buffer physically, if it holds the transposed matrix
+  */
+  void Materialize() const;
 
 public:
+  /**
+  * Alignment of the buffer and of every column in bytes
+  */
+  static const int ALIGNMENT = 64;
+
+  /**
+  * @fn        LeadingDimension
+  * @returns   Height rounded up to the whole cache line
+  */
+  static int LeadingDimension(int height);
+
   DenseMatrix(int width,int height);
+
+  /**
+  * @brief     Shares the buffer of other, see the details of the class
+  */
+  DenseMatrix(const DenseMatrix& other) = default;
+
+  /**
+  * @brief     View of width x height block of parent at x, y, which shares the buffer of parent
+  * @details   No element is copied, the view is copied to its own buffer on its first modification.
+  */
+  DenseMatrix(const DenseMatrix& parent, int x, int y, int width, int height);
+
+  /**
+  * @brief     Uses buffer of width columns of ld doubles, which is released by its deleter (a mapped file)
+  * @details   Columns should be aligned as those of an allocated buffer, their padding isn't touched.
+  */
+  DenseMatrix(int width, int height, std::shared_ptr<double> buffer, int ld);
+
+  DenseMatrix& operator=(const DenseMatrix& other) = default;
+
+  /**
+  * @fn        IsShared
+  * @returns   True, if another matrix uses the same buffer
+  */
+  bool IsShared() const;
+
+  /**
+  * @fn        IsTransposed
+  * @returns   True, if the buffer holds the transposed matrix, see the details of the class
+  */
+  bool IsTransposed() const;
+
+  /**
+  * @fn        GetLayout
+  * @brief     Buffer as it's stored, without transposing it physically
+  * @param     ld - Distance between two neighbouring columns of the buffer
+  * @param     transposed - Set to IsTransposed(): the buffer is width x height instead of height x width
+  * @returns   Pointer to the first element of the buffer
+  */
+  const double * GetLayout(int& ld, bool& transposed) const;
+
   double At(int x, int y) const override;
 
   void SetAt(int x, int y, double val) override;
@@ -28,7 +123,63 @@ public:
 
   void Transpose() override;
 
-  ~DenseMatrix() override ;
+  /**
+  * @fn        GetLeadingDimension
+  * @returns   Distance between two neighbouring columns in the buffer
+  */
+  int GetLeadingDimension() const;
+
+  /**
+  * @fn        Data
+  * @returns   Pointer to the first element of the buffer
+  */
+  double * Data();
+  const double * Data() const;
+
+  /**
+  * @fn        Column
+  * @returns   Pointer to the contiguous x-th column (height elements)
+  */
+  double * Column(int x);
+  const double * Column(int x) const;
+
+  /**
+  * @fn        Row
+  * @returns   Pointer to the first element of y-th row
+  * @details   Elements of the row are GetLeadingDimension() doubles apart.
+  */
+  double * Row(int y);
+  const double * Row(int y) const;
+
+  /**
+  * @fn        GetColumnSpan
+  * @returns   View of x-th column, which is strided, if the matrix is transposed
+  */
+  Span GetColumnSpan(int x);
+  ConstSpan GetColumnSpan(int x) const;
+
+  /**
+  * @fn        GetRowSpan
+  * @returns   View of y-th row, which is contiguous, if the matrix is transposed
+  */
+  Span GetRowSpan(int y);
+  ConstSpan GetRowSpan(int y) const;
+
+  void SwapRows(int row1, int row2) override;
+
+  void ScalarMul(double num) override;
+
+  void CopyTo(double * buffer, int ld) const override;
+
+  void FillFrom(const double * buffer, int ld) override;
+
+  void CopyRowTo(int y, double * buffer) const override;
+
+  void CopyColumnTo(int x, double * buffer) const override;
+
+  long long ReadNonZeros(long long cursor, Entry * out, int max, int& count) const override;
+
+  ~DenseMatrix() override = default;
 };
 
 
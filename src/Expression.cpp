@@ -0,0 +1,47 @@
+#include "Expression.h"
+
+Expression::Expression(const std::string& name) : type(VARIABLE), name(name), number(0), scalar(false)
+{
+
+}
+
+Expression::Expression(double number) : type(NUMBER), number(number), scalar(true)
+{
+
+}
+
+Expression::Expression(Type type, std::unique_ptr<Expression> left, std::unique_ptr<Expression> right)
+    : type(type), number(0), left(std::move(left)), right(std::move(right))
+{
+  scalar = this->left->IsScalar() && (!this->right || this->right->IsScalar());
+}
+
+Expression::Type Expression::GetType() const
+{
+  return type;
+}
+
+const std::string& Expression::GetName() const
+{
+  return name;
+}
+
+double Expression::GetNumber() const
+{
+  return number;
+}
+
+const Expression * Expression::GetLeft() const
+{
+  return left.get();
+}
+
+const Expression * Expression::GetRight() const
+{
+  return right.get();
+}
+
+bool Expression::IsScalar() const
+{
+  return scalar;
+}
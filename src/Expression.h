@@ -0,0 +1,93 @@
+/**
+* @file         Expression.h
+* @date         18.10.2026
+* @brief        Definition of the Expression
+* @author       miklilad
+*/
+#ifndef SEM_EXPRESSION_H
+#define SEM_EXPRESSION_H
+
+#include <memory>
+#include <string>
+
+/**
+* @class    Expression
+* @brief    Node of the syntax tree of an expression over matrix variables and numbers
+* @details  Leaves are variables and numbers, inner nodes are +, -, * with two operands
+* @details  and unary minus with one. Children are owned by the node.
+*/
+class Expression
+{
+public:
+  /**
+  * @enum     Type
+  * @brief    Kind of the node
+  */
+  enum Type
+  {
+    VARIABLE, NUMBER, ADD, SUBTRACT, MULTIPLY, NEGATE
+  };
+
+private:
+  Type type;
+  std::string name;
+  double number;
+  std::unique_ptr<Expression> left;
+  std::unique_ptr<Expression> right;
+  bool scalar;
+
+public:
+  /**
+  * @brief     Creates a variable leaf
+  */
+  explicit Expression(const std::string& name);
+
+  /**
+  * @brief     Creates a number leaf
+  */
+  explicit Expression(double number);
+
+  /**
+  * @brief     Creates an operation, right is nullptr for NEGATE
+  */
+  Expression(Type type, std::unique_ptr<Expression> left, std::unique_ptr<Expression> right = nullptr);
+
+  /**
+  * @fn        GetType
+  * @returns   Kind of the node
+  */
+  Type GetType() const;
+
+  /**
+  * @fn        GetName
+  * @returns   Name of the variable
+  */
+  const std::string& GetName() const;
+
+  /**
+  * @fn        GetNumber
+  * @returns   Value of the number
+  */
+  double GetNumber() const;
+
+  /**
+  * @fn        GetLeft
+  * @returns   First operand or nullptr for leaves
+  */
+  const Expression * GetLeft() const;
+
+  /**
+  * @fn        GetRight
+  * @returns   Second operand or nullptr for leaves and NEGATE
+  */
+  const Expression * GetRight() const;
+
+  /**
+  * @fn        IsScalar
+  * @returns   True, if the subtree has no variables and its value is a number
+  */
+  bool IsScalar() const;
+};
+
+
+#endif
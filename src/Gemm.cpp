@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <vector>
+#include "Gemm.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GEMM_AVX2
+#include <immintrin.h>
+#endif
+
+const int Gemm::MR;
+const int Gemm::NR;
+const int Gemm::KC;
+const int Gemm::MC;
+const int Gemm::NC;
+
+void Gemm::Multiply(int m, int n, int k, double alpha, const double * a, int lda,
+                    const double * b, int ldb, double beta, double * c, int ldc, ThreadPool * pool)
+{
+  Multiply(false, false, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc, pool);
+}
+
+void Gemm::Multiply(bool transA, bool transB, int m, int n, int k, double alpha, const double * a, int lda,
+                    const double * b, int ldb, double beta, double * c, int ldc, ThreadPool * pool)
+{
+  int aRow = transA ? lda : 1;
+  int aCol = transA ? 1 : lda;
+  int bRow = transB ? ldb : 1;
+  int bCol = transB ? 1 : ldb;
+  int threads = pool ? pool->GetThreadCount() : 1;
+  if (threads == 1 || (long) m * n * k < PARALLELTHRESHOLD)
+  {
+    MultiplyBlock(m, n, k, alpha, a, aRow, aCol, b, bRow, bCol, beta, c, ldc);
+    return;
+  }
+  // Columns are split first, every tile then packs only its own part of B
+  int wanted = 4 * threads;
+  int colTiles = std::min((n + NR - 1) / NR, wanted);
+  int rowTiles = std::min((m + MR - 1) / MR, (wanted + colTiles - 1) / colTiles);
+  int tileN = ((n + colTiles - 1) / colTiles + NR - 1) / NR * NR;
+  int tileM = ((m + rowTiles - 1) / rowTiles + MR - 1) / MR * MR;
+  colTiles = (n + tileN - 1) / tileN;
+  rowTiles = (m + tileM - 1) / tileM;
+  pool->Run(colTiles * rowTiles, [&](int tile)
+  {
+    int i = tile % rowTiles * tileM;
+    int j = tile / rowTiles * tileN;
+    MultiplyBlock(std::min(tileM, m - i), std::min(tileN, n - j), k, alpha, a + (size_t) i * aRow, aRow, aCol,
+                  b + (size_t) j * bCol, bRow, bCol, beta, c + (size_t) j * ldc + i, ldc);
+  });
+}
+
+void Gemm::MultiplyBlock(int m, int n, int k, double alpha, const double * a, int aRow, int aCol,
+                         const double * b, int bRow, int bCol, double beta, double * c, int ldc)
+{
+  static const Kernel kernel = SelectKernel();
+  if (k == 0)
+  {
+    for (int j = 0; j < n; ++j)
+      for (int i = 0; i < m; ++i)
+        c[(size_t) j * ldc + i] = beta == 0 ? 0 : beta * c[(size_t) j * ldc + i];
+    return;
+  }
+  std::vector<double> packedA((size_t) MC * KC);
+  std::vector<double> packedB((size_t) KC * (std::min(n, NC) + NR));
+  double edge[MR * NR];
+
+  for (int jc = 0; jc < n; jc += NC)
+  {
+    int nc = std::min(NC, n - jc);
+    for (int pc = 0; pc < k; pc += KC)
+    {
+      int kc = std::min(KC, k - pc);
+      double betaBlock = pc == 0 ? beta : 1;
+      PackB(kc, nc, b + (size_t) jc * bCol + (size_t) pc * bRow, bRow, bCol, packedB.data());
+      for (int ic = 0; ic < m; ic += MC)
+      {
+        int mc = std::min(MC, m - ic);
+        PackA(mc, kc, a + (size_t) pc * aCol + (size_t) ic * aRow, aRow, aCol, packedA.data());
+        for (int jr = 0; jr < nc; jr += NR)
+        {
+          int nr = std::min(NR, nc - jr);
+          const double * bSliver = packedB.data() + (size_t) jr * kc;
+          for (int ir = 0; ir < mc; ir += MR)
+          {
+            int mr = std::min(MR, mc - ir);
+            const double * aSliver = packedA.data() + (size_t) ir * kc;
+            double * cTile = c + (size_t) (jc + jr) * ldc + ic + ir;
+            if (mr == MR && nr == NR)
+            {
+              kernel(kc, aSliver, bSliver, cTile, ldc, alpha, betaBlock);
+              continue;
+            }
+            kernel(kc, aSliver, bSliver, edge, MR, alpha, 0);
+            for (int j = 0; j < nr; ++j)
+              for (int i = 0; i < mr; ++i)
+              {
+                double& dest = cTile[(size_t) j * ldc + i];
+                dest = betaBlock == 0 ? edge[j * MR + i] : edge[j * MR + i] + betaBlock * dest;
+              }
+          }
+        }
+      }
+    }
+  }
+}
+
+void Gemm::PackA(int mc, int kc, const double * a, int aRow, int aCol, double * packed)
+{
+  for (int ir = 0; ir < mc; ir += MR)
+  {
+    int mr = std::min(MR, mc - ir);
+    for (int p = 0; p < kc; ++p)
+    {
+      const double * column = a + (size_t) p * aCol + (size_t) ir * aRow;
+      int i = 0;
+      if (aRow == 1)
+        for (; i < mr; ++i)
+          packed[i] = column[i];
+      else
+        for (; i < mr; ++i)
+          packed[i] = column[(size_t) i * aRow];
+      for (; i < MR; ++i)
+        packed[i] = 0;
+      packed += MR;
+    }
+  }
+}
+
+void Gemm::PackB(int kc, int nc, const double * b, int bRow, int bCol, double * packed)
+{
+  for (int jr = 0; jr < nc; jr += NR)
+  {
+    int nr = std::min(NR, nc - jr);
+    for (int p = 0; p < kc; ++p)
+    {
+      int j = 0;
+      for (; j < nr; ++j)
+        packed[j] = b[(size_t) (jr + j) * bCol + (size_t) p * bRow];
+      for (; j < NR; ++j)
+        packed[j] = 0;
+      packed += NR;
+    }
+  }
+}
+
+void Gemm::KernelScalar(int kc, const double * a, const double * b, double * c, int ldc,
+                        double alpha, double beta)
+{
+  double acc[NR][MR] = {};
+  for (int p = 0; p < kc; ++p)
+  {
+    for (int j = 0; j < NR; ++j)
+      for (int i = 0; i < MR; ++i)
+        acc[j][i] += a[i] * b[j];
+    a += MR;
+    b += NR;
+  }
+  for (int j = 0; j < NR; ++j)
+  {
+    double * column = c + (size_t) j * ldc;
+    for (int i = 0; i < MR; ++i)
+      column[i] = beta == 0 ? alpha * acc[j][i] : alpha * acc[j][i] + beta * column[i];
+  }
+}
+
+#ifdef GEMM_AVX2
+
+__attribute__((target("avx2,fma")))
+void Gemm::KernelAvx2(int kc, const double * a, const double * b, double * c, int ldc,
+                      double alpha, double beta)
+{
+  __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+  __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+  __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+  __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+  __m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+  __m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+  for (int p = 0; p < kc; ++p)
+  {
+    __m256d a0 = _mm256_loadu_pd(a);
+    __m256d a1 = _mm256_loadu_pd(a + 4);
+    __m256d bj = _mm256_broadcast_sd(b);
+    c00 = _mm256_fmadd_pd(a0, bj, c00);
+    c01 = _mm256_fmadd_pd(a1, bj, c01);
+    bj = _mm256_broadcast_sd(b + 1);
+    c10 = _mm256_fmadd_pd(a0, bj, c10);
+    c11 = _mm256_fmadd_pd(a1, bj, c11);
+    bj = _mm256_broadcast_sd(b + 2);
+    c20 = _mm256_fmadd_pd(a0, bj, c20);
+    c21 = _mm256_fmadd_pd(a1, bj, c21);
+    bj = _mm256_broadcast_sd(b + 3);
+    c30 = _mm256_fmadd_pd(a0, bj, c30);
+    c31 = _mm256_fmadd_pd(a1, bj, c31);
+    bj = _mm256_broadcast_sd(b + 4);
+    c40 = _mm256_fmadd_pd(a0, bj, c40);
+    c41 = _mm256_fmadd_pd(a1, bj, c41);
+    bj = _mm256_broadcast_sd(b + 5);
+    c50 = _mm256_fmadd_pd(a0, bj, c50);
+    c51 = _mm256_fmadd_pd(a1, bj, c51);
+    a += MR;
+    b += NR;
+  }
+  __m256d acc[NR][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+  __m256d alphaV = _mm256_set1_pd(alpha);
+  __m256d betaV = _mm256_set1_pd(beta);
+  for (int j = 0; j < NR; ++j)
+  {
+    double * column = c + (size_t) j * ldc;
+    for (int h = 0; h < 2; ++h)
+    {
+      __m256d val = _mm256_mul_pd(alphaV, acc[j][h]);
+      if (beta != 0)
+        val = _mm256_fmadd_pd(betaV, _mm256_loadu_pd(column + 4 * h), val);
+      _mm256_storeu_pd(column + 4 * h, val);
+    }
+  }
+}
+
+Gemm::Kernel Gemm::SelectKernel()
+{
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return KernelAvx2;
+  return KernelScalar;
+}
+
+#else
+
+void Gemm::KernelAvx2(int kc, const double * a, const double * b, double * c, int ldc,
+                      double alpha, double beta)
+{
+  KernelScalar(kc, a, b, c, ldc, alpha, beta);
+}
+
+Gemm::Kernel Gemm::SelectKernel()
+{
+  return KernelScalar;
+}
+
+#endif
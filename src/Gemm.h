@@ -0,0 +1,125 @@
+/**
+* @file         Gemm.h
+* @date         18.10.2026
+* @brief        Definition of the Gemm
+* @author       miklilad
+*/
+#ifndef SEM_GEMM_H
+#define SEM_GEMM_H
+
+#include "ThreadPool.h"
+
+/**
+* @class    Gemm
+* @brief    Dense matrix multiplication kernel
+* @details  Computes C = alpha * A * B + beta * C on column-major buffers, where A is m x k,
+* @details  B is k x n and C is m x n. Operands are packed into cache-sized panels and the product
+* @details  of each MR x NR tile is accumulated in registers by a micro-kernel. AVX2/FMA micro-kernel
+* @details  is chosen at runtime when the CPU supports it, portable one is used otherwise.
+* @details  With a thread pool, C is split into tiles, which are computed by the workers.
+*/
+class Gemm
+{
+public:
+  /**
+  * Rows of C computed by one micro-kernel call
+  */
+  static const int MR = 8;
+
+  /**
+  * Columns of C computed by one micro-kernel call
+  */
+  static const int NR = 6;
+
+  /**
+  * Depth of packed panels, chosen so that an MR x KC sliver of A and KC x NR sliver of B fit into L1
+  */
+  static const int KC = 256;
+
+  /**
+  * Rows of packed block of A, chosen so that MC x KC block fits into L2
+  */
+  static const int MC = 96;
+
+  /**
+  * Columns of packed block of B, chosen so that KC x NC block fits into L3
+  */
+  static const int NC = 4080;
+
+  /**
+  * Smallest number of multiply-adds worth splitting between threads
+  */
+  static const long PARALLELTHRESHOLD = 1L << 20;
+
+  /**
+  * @fn        Multiply
+  * @brief     C = alpha * A * B + beta * C
+  * @param     lda, ldb, ldc - Distances between two columns of A, B and C
+  * @param     pool - Workers to split the work among, nullptr to run in the calling thread
+  * @details   C isn't read, when beta is 0.
+  */
+  static void Multiply(int m, int n, int k, double alpha, const double * a, int lda,
+                       const double * b, int ldb, double beta, double * c, int ldc,
+                       ThreadPool * pool = nullptr);
+
+  /**
+  * @fn        Multiply
+  * @brief     C = alpha * op(A) * op(B) + beta * C, where op(X) is X or X^T
+  * @param     transA, transB - a holds k x m A^T instead of m x k A, b holds n x k B^T instead of k x n B
+  * @details   Transposed operands are read directly while they are packed, so they are never copied whole.
+  */
+  static void Multiply(bool transA, bool transB, int m, int n, int k, double alpha, const double * a, int lda,
+                       const double * b, int ldb, double beta, double * c, int ldc,
+                       ThreadPool * pool = nullptr);
+
+private:
+  /**
+  * @fn        MultiplyBlock
+  * @brief     Serial version of Multiply
+  * @param     aRow, aCol - Distances between elements of A in neighbouring rows and columns, same for B
+  */
+  static void MultiplyBlock(int m, int n, int k, double alpha, const double * a, int aRow, int aCol,
+                            const double * b, int bRow, int bCol, double beta, double * c, int ldc);
+
+  typedef void (* Kernel)(int kc, const double * a, const double * b, double * c, int ldc,
+                          double alpha, double beta);
+
+  /**
+  * @fn        SelectKernel
+  * @returns   Best micro-kernel for this CPU
+  */
+  static Kernel SelectKernel();
+
+  /**
+  * @fn        KernelScalar
+  * @brief     Portable micro-kernel: C[MR x NR] = alpha * A * B + beta * C
+  * @param     a - Packed MR x kc sliver of A
+  * @param     b - Packed kc x NR sliver of B
+  */
+  static void KernelScalar(int kc, const double * a, const double * b, double * c, int ldc,
+                           double alpha, double beta);
+
+  /**
+  * @fn        KernelAvx2
+  * @brief     AVX2/FMA version of KernelScalar
+  */
+  static void KernelAvx2(int kc, const double * a, const double * b, double * c, int ldc,
+                         double alpha, double beta);
+
+  /**
+  * @fn        PackA
+  * @brief     Copies mc x kc block of A to MR-row slivers, padding the last one by zeroes
+  * @param     aRow, aCol - Distances between elements of A in neighbouring rows and columns
+  */
+  static void PackA(int mc, int kc, const double * a, int aRow, int aCol, double * packed);
+
+  /**
+  * @fn        PackB
+  * @brief     Copies kc x nc block of B to NR-column slivers, padding the last one by zeroes
+  * @param     bRow, bCol - Distances between elements of B in neighbouring rows and columns
+  */
+  static void PackB(int kc, int nc, const double * b, int bRow, int bCol, double * packed);
+};
+
+
+#endif
@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "SparseKernels.h"
+#include "IterativeSolver.h"
+
+IterativeSolver::IterativeSolver(const SparseMatrix& a, const Settings& settings, ThreadPool * pool)
+    : a(a), settings(settings), pool(pool), size(a.GetHeight())
+{
+  if (a.GetWidth() != a.GetHeight())
+    std::__throw_invalid_argument("Not a square matrix!");
+  const int * rowPtr = a.GetRowPointers();
+  const int * colIdx = a.GetColumnIndices();
+  const double * values = a.GetValues();
+  diagonalPos.assign(size, -1);
+  for (int y = 0; y < size; ++y)
+  {
+    const int * pos = std::lower_bound(colIdx + rowPtr[y], colIdx + rowPtr[y + 1], y);
+    if (pos != colIdx + rowPtr[y + 1] && *pos == y && values[pos - colIdx] != 0)
+      diagonalPos[y] = pos - colIdx;
+  }
+  if (settings.preconditioner == NONE)
+    return;
+  if (std::find(diagonalPos.begin(), diagonalPos.end(), -1) != diagonalPos.end())
+    std::__throw_invalid_argument("Zero on the diagonal!");
+  if (settings.preconditioner == JACOBI)
+  {
+    inverseDiagonal.resize(size);
+    for (int y = 0; y < size; ++y)
+      inverseDiagonal[y] = 1 / values[diagonalPos[y]];
+  }
+  else
+    FactorizeIlu();
+}
+
+void IterativeSolver::FactorizeIlu()
+{
+  const int * rowPtr = a.GetRowPointers();
+  const int * colIdx = a.GetColumnIndices();
+  ilu.assign(a.GetValues(), a.GetValues() + rowPtr[size]);
+  // Row by row (IKJ), updates outside of the pattern of A are dropped
+  std::vector<int> position(size, -1);
+  for (int y = 0; y < size; ++y)
+  {
+    for (int i = rowPtr[y]; i < rowPtr[y + 1]; ++i)
+      position[colIdx[i]] = i;
+    for (int i = rowPtr[y]; i < diagonalPos[y]; ++i)
+    {
+      int k = colIdx[i];
+      ilu[i] /= ilu[diagonalPos[k]];
+      double factor = ilu[i];
+      for (int j = diagonalPos[k] + 1; j < rowPtr[k + 1]; ++j)
+        if (position[colIdx[j]] != -1)
+          ilu[position[colIdx[j]]] -= factor * ilu[j];
+    }
+    for (int i = rowPtr[y]; i < rowPtr[y + 1]; ++i)
+      position[colIdx[i]] = -1;
+    if (ilu[diagonalPos[y]] == 0)
+      std::__throw_invalid_argument("Zero pivot in incomplete factorization!");
+  }
+}
+
+void IterativeSolver::Multiply(const double * x, double * y) const
+{
+  SparseKernels::MultiplyDense(a, x, size, 1, y, size, pool);
+}
+
+void IterativeSolver::Precondition(const double * r, double * z) const
+{
+  if (settings.preconditioner == NONE)
+    std::copy(r, r + size, z);
+  else if (settings.preconditioner == JACOBI)
+    for (int y = 0; y < size; ++y)
+      z[y] = r[y] * inverseDiagonal[y];
+  else
+  {
+    const int * rowPtr = a.GetRowPointers();
+    const int * colIdx = a.GetColumnIndices();
+    for (int y = 0; y < size; ++y)
+    {
+      double sum = r[y];
+      for (int i = rowPtr[y]; i < diagonalPos[y]; ++i)
+        sum -= ilu[i] * z[colIdx[i]];
+      z[y] = sum;
+    }
+    for (int y = size - 1; y >= 0; --y)
+    {
+      double sum = z[y];
+      for (int i = diagonalPos[y] + 1; i < rowPtr[y + 1]; ++i)
+        sum -= ilu[i] * z[colIdx[i]];
+      z[y] = sum / ilu[diagonalPos[y]];
+    }
+  }
+}
+
+double IterativeSolver::Dot(const std::vector<double>& x, const std::vector<double>& y) const
+{
+  double sum = 0;
+  for (int i = 0; i < size; ++i)
+    sum += x[i] * y[i];
+  return sum;
+}
+
+double IterativeSolver::Norm(const std::vector<double>& x) const
+{
+  return std::sqrt(Dot(x, x));
+}
+
+IterativeSolver::Result IterativeSolver::Solve(const double * b, double * x) const
+{
+  double bNorm = 0;
+  for (int i = 0; i < size; ++i)
+    bNorm += b[i] * b[i];
+  bNorm = std::sqrt(bNorm);
+  if (bNorm == 0)
+  {
+    std::fill(x, x + size, 0.0);
+    return {0, 0, true};
+  }
+  if (settings.method == CG)
+    return SolveCG(b, x, bNorm);
+  if (settings.method == BICGSTAB)
+    return SolveBiCGSTAB(b, x, bNorm);
+  return SolveGMRES(b, x, bNorm);
+}
+
+IterativeSolver::Result IterativeSolver::SolveCG(const double * b, double * x, double bNorm) const
+{
+  std::vector<double> r(size), z(size), p(size), q(size);
+  Multiply(x, r.data());
+  for (int i = 0; i < size; ++i)
+    r[i] = b[i] - r[i];
+  Result result = {0, Norm(r) / bNorm, false};
+  Precondition(r.data(), z.data());
+  p = z;
+  double rz = Dot(r, z);
+  while (result.residual > settings.tolerance && result.iterations < settings.maxIterations)
+  {
+    Multiply(p.data(), q.data());
+    double pq = Dot(p, q);
+    if (pq == 0)
+      break;
+    double alpha = rz / pq;
+    for (int i = 0; i < size; ++i)
+    {
+      x[i] += alpha * p[i];
+      r[i] -= alpha * q[i];
+    }
+    result.iterations++;
+    result.residual = Norm(r) / bNorm;
+    Precondition(r.data(), z.data());
+    double rzNew = Dot(r, z);
+    double beta = rzNew / rz;
+    rz = rzNew;
+    for (int i = 0; i < size; ++i)
+      p[i] = z[i] + beta * p[i];
+  }
+  result.converged = result.residual <= settings.tolerance;
+  return result;
+}
+
+IterativeSolver::Result IterativeSolver::SolveBiCGSTAB(const double * b, double * x, double bNorm) const
+{
+  std::vector<double> r(size), rHat, p(size, 0), v(size, 0), pHat(size), s(size), sHat(size), t(size);
+  Multiply(x, r.data());
+  for (int i = 0; i < size; ++i)
+    r[i] = b[i] - r[i];
+  rHat = r;
+  Result result = {0, Norm(r) / bNorm, false};
+  double rho = 1, alpha = 1, omega = 1;
+  while (result.residual > settings.tolerance && result.iterations < settings.maxIterations)
+  {
+    double rhoNew = Dot(rHat, r);
+    if (rhoNew == 0 || omega == 0)
+      break;
+    double beta = rhoNew / rho * alpha / omega;
+    rho = rhoNew;
+    for (int i = 0; i < size; ++i)
+      p[i] = r[i] + beta * (p[i] - omega * v[i]);
+    Precondition(p.data(), pHat.data());
+    Multiply(pHat.data(), v.data());
+    result.iterations++;
+    double rHatV = Dot(rHat, v);
+    if (rHatV == 0)
+      break;
+    alpha = rho / rHatV;
+    for (int i = 0; i < size; ++i)
+      s[i] = r[i] - alpha * v[i];
+    result.residual = Norm(s) / bNorm;
+    if (result.residual <= settings.tolerance)
+    {
+      for (int i = 0; i < size; ++i)
+        x[i] += alpha * pHat[i];
+      break;
+    }
+    Precondition(s.data(), sHat.data());
+    Multiply(sHat.data(), t.data());
+    result.iterations++;
+    double tt = Dot(t, t);
+    omega = tt == 0 ? 0 : Dot(t, s) / tt;
+    for (int i = 0; i < size; ++i)
+    {
+      x[i] += alpha * pHat[i] + omega * sHat[i];
+      r[i] = s[i] - omega * t[i];
+    }
+    result.residual = Norm(r) / bNorm;
+  }
+  result.converged = result.residual <= settings.tolerance;
+  return result;
+}
+
+IterativeSolver::Result IterativeSolver::SolveGMRES(const double * b, double * x, double bNorm) const
+{
+  int restart = std::max(1, std::min(settings.restart, size));
+  std::vector<std::vector<double>> basis(restart + 1, std::vector<double>(size));
+  // Column j of the Hessenberg matrix has j + 2 elements
+  std::vector<std::vector<double>> h(restart, std::vector<double>(restart + 1));
+  std::vector<double> cs(restart), sn(restart), g(restart + 1), y(restart), z(size), w(size);
+  Result result = {0, 0, false};
+  while (true)
+  {
+    std::vector<double>& r = basis[0];
+    Multiply(x, r.data());
+    for (int i = 0; i < size; ++i)
+      r[i] = b[i] - r[i];
+    double beta = Norm(r);
+    result.residual = beta / bNorm;
+    if (result.residual <= settings.tolerance || result.iterations >= settings.maxIterations || beta == 0)
+      break;
+    for (int i = 0; i < size; ++i)
+      r[i] /= beta;
+    std::fill(g.begin(), g.end(), 0.0);
+    g[0] = beta;
+    int steps = 0;
+    while (steps < restart && result.iterations < settings.maxIterations)
+    {
+      int j = steps++;
+      Precondition(basis[j].data(), z.data());
+      Multiply(z.data(), w.data());
+      result.iterations++;
+      std::vector<double>& column = h[j];
+      for (int i = 0; i <= j; ++i)
+      {
+        column[i] = Dot(w, basis[i]);
+        for (int k = 0; k < size; ++k)
+          w[k] -= column[i] * basis[i][k];
+      }
+      column[j + 1] = Norm(w);
+      if (column[j + 1] != 0)
+        for (int k = 0; k < size; ++k)
+          basis[j + 1][k] = w[k] / column[j + 1];
+      for (int i = 0; i < j; ++i)
+      {
+        double temp = cs[i] * column[i] + sn[i] * column[i + 1];
+        column[i + 1] = -sn[i] * column[i] + cs[i] * column[i + 1];
+        column[i] = temp;
+      }
+      double radius = std::hypot(column[j], column[j + 1]);
+      cs[j] = radius == 0 ? 1 : column[j] / radius;
+      sn[j] = radius == 0 ? 0 : column[j + 1] / radius;
+      column[j] = radius;
+      column[j + 1] = 0;
+      g[j + 1] = -sn[j] * g[j];
+      g[j] = cs[j] * g[j];
+      result.residual = std::fabs(g[j + 1]) / bNorm;
+      if (result.residual <= settings.tolerance || radius == 0)
+        break;
+    }
+    // x += M^-1 * V * y, where H * y = g
+    for (int i = steps - 1; i >= 0; --i)
+    {
+      double sum = g[i];
+      for (int k = i + 1; k < steps; ++k)
+        sum -= h[k][i] * y[k];
+      y[i] = h[i][i] == 0 ? 0 : sum / h[i][i];
+    }
+    std::fill(w.begin(), w.end(), 0.0);
+    for (int i = 0; i < steps; ++i)
+      for (int k = 0; k < size; ++k)
+        w[k] += y[i] * basis[i][k];
+    Precondition(w.data(), z.data());
+    for (int k = 0; k < size; ++k)
+      x[k] += z[k];
+  }
+  result.converged = result.residual <= settings.tolerance;
+  return result;
+}
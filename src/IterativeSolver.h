@@ -0,0 +1,142 @@
+/**
+* @file         IterativeSolver.h
+* @date         18.10.2026
+* @brief        Definition of the IterativeSolver
+* @author       miklilad
+*/
+#ifndef SEM_ITERATIVESOLVER_H
+#define SEM_ITERATIVESOLVER_H
+
+#include <vector>
+#include "SparseMatrix.h"
+#include "ThreadPool.h"
+
+/**
+* @class    IterativeSolver
+* @brief    Krylov subspace solvers of A * x = b for square SparseMatrix A
+* @details  Only products of A with vectors are needed, so the memory stays at the nonzeros of A
+* @details  and a few vectors (restart + 1 of them for GMRES). Preconditioner M is applied from the left
+* @details  in CG and from the right in BiCGSTAB and GMRES, so the reported residual is always ||b - A * x|| / ||b||.
+*/
+class IterativeSolver
+{
+public:
+  /**
+  * @enum     Method
+  * @brief    CG for symmetric positive definite A, BiCGSTAB and restarted GMRES for any A
+  */
+  enum Method
+  {
+    CG, BICGSTAB, GMRES
+  };
+
+  /**
+  * @enum     Preconditioner
+  * @brief    NONE, JACOBI (inverse of the diagonal) or ILU0 (incomplete LU with the pattern of A)
+  */
+  enum Preconditioner
+  {
+    NONE, JACOBI, ILU0
+  };
+
+  /**
+  * @struct   Settings
+  * @brief    Solver and its stopping criteria
+  */
+  struct Settings
+  {
+    Method method = BICGSTAB;
+    Preconditioner preconditioner = JACOBI;
+    double tolerance = 1e-10;
+    int maxIterations = 1000;
+    int restart = 30;
+  };
+
+  /**
+  * @struct   Result
+  * @brief    Number of iterations (products with A) and relative residual reached
+  */
+  struct Result
+  {
+    int iterations;
+    double residual;
+    bool converged;
+  };
+
+private:
+  const SparseMatrix& a;
+  Settings settings;
+  ThreadPool * pool;
+  int size;
+  std::vector<double> inverseDiagonal;
+  std::vector<double> ilu;
+  std::vector<int> diagonalPos;
+
+  /**
+  * @fn        Multiply
+  * @brief     y = A * x
+  */
+  void Multiply(const double * x, double * y) const;
+
+  /**
+  * @fn        Precondition
+  * @brief     z = M^-1 * r, z and r may be the same
+  */
+  void Precondition(const double * r, double * z) const;
+
+  /**
+  * @fn        FactorizeIlu
+  * @brief     Computes incomplete LU factors of A, which keep the pattern of A
+  */
+  void FactorizeIlu();
+
+  /**
+  * @fn        Dot
+  * @returns   Dot product of x and y
+  */
+  double Dot(const std::vector<double>& x, const std::vector<double>& y) const;
+
+  /**
+  * @fn        Norm
+  * @returns   Euclidean norm of x
+  */
+  double Norm(const std::vector<double>& x) const;
+
+  /**
+  * @fn        SolveCG
+  * @brief     Preconditioned conjugate gradient
+  */
+  Result SolveCG(const double * b, double * x, double bNorm) const;
+
+  /**
+  * @fn        SolveBiCGSTAB
+  * @brief     Right-preconditioned stabilized biconjugate gradient
+  */
+  Result SolveBiCGSTAB(const double * b, double * x, double bNorm) const;
+
+  /**
+  * @fn        SolveGMRES
+  * @brief     Right-preconditioned GMRES restarted after settings.restart iterations
+  * @details   Arnoldi basis is orthogonalized by modified Gram-Schmidt and the least squares problem
+  * @details   is kept triangular by Givens rotations, so the residual is known in every iteration.
+  */
+  Result SolveGMRES(const double * b, double * x, double bNorm) const;
+
+public:
+  /**
+  * @brief     Prepares the preconditioner of a
+  * @details   Throws std::invalid_argument for matrix, which isn't square, or for a zero on the diagonal,
+  * @details   which the preconditioner can't divide by. a has to outlive the solver.
+  */
+  IterativeSolver(const SparseMatrix& a, const Settings& settings, ThreadPool * pool = nullptr);
+
+  /**
+  * @fn        Solve
+  * @brief     Solves A * x = b
+  * @param     x - Initial guess, which is overwritten by the solution
+  */
+  Result Solve(const double * b, double * x) const;
+};
+
+
+#endif
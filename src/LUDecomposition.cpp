@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include "Gemm.h"
+#include "LUDecomposition.h"
+
+LUDecomposition::LUDecomposition(const Matrix& m, Pivoting pivoting, ThreadPool * pool)
+    : lu(m.GetWidth(), m.GetHeight()), perm(m.GetHeight()), rowSigns(m.GetHeight(), 1), sign(1), pivoting(pivoting)
+{
+  int height = m.GetHeight();
+  int ld = lu.GetLeadingDimension();
+  m.CopyTo(lu.Data(), ld);
+  for (int y = 0; y < height; ++y)
+    perm[y] = y;
+  for (int x = 0; x < lu.GetWidth(); ++x)
+  {
+    const double * column = lu.Column(x);
+    double scale = 0;
+    for (int y = 0; y < height; ++y)
+      scale = std::max(scale, std::fabs(column[y]));
+    columnScales.push_back(scale);
+  }
+  Factorize(pool);
+}
+
+int LUDecomposition::FindPivot(const double * column, int start) const
+{
+  int height = lu.GetHeight();
+  int pivot = -1;
+  if (pivoting == PARTIAL)
+  {
+    double max = 0;
+    for (int y = start; y < height; ++y)
+      if (std::fabs(column[y]) > max)
+      {
+        max = std::fabs(column[y]);
+        pivot = y;
+      }
+    return pivot;
+  }
+  for (int y = start; y < height; ++y)
+    if (column[y] != 0 && (pivot == -1 || std::fabs(column[y]) < std::fabs(column[pivot])))
+      pivot = y;
+  return pivot;
+}
+
+void LUDecomposition::SwapRows(int row1, int row2, int first, int last)
+{
+  std::swap(perm[row1], perm[row2]);
+  if (pivoting == GEM)
+  {
+    std::swap(rowSigns[row1], rowSigns[row2]);
+    rowSigns[row2] = -rowSigns[row2];
+  }
+  else
+    sign = -sign;
+  for (int x = first; x < last; ++x)
+    SwapInColumn(lu.Column(x), row1, row2);
+}
+
+void LUDecomposition::SwapInColumn(double * column, int row1, int row2) const
+{
+  double num = column[row1];
+  column[row1] = column[row2];
+  if (pivoting == GEM)
+    column[row2] = num != 0 ? -num : 0;
+  else
+    column[row2] = num;
+}
+
+void LUDecomposition::Factorize(ThreadPool * pool)
+{
+  int width = lu.GetWidth();
+  int height = lu.GetHeight();
+  int row = 0;
+  std::vector<int> swaps;
+  for (int first = 0; first < width && row < height; first += BLOCK)
+  {
+    int last = std::min(first + BLOCK, width);
+    int firstRow = row;
+    int firstPivot = pivotColumns.size();
+    swaps.clear();
+    // Panel is eliminated column by column, the columns outside of it wait for the swaps and UpdateTrailing
+    for (int x = first; x < last && row < height; ++x)
+    {
+      double * column = lu.Column(x);
+      int pivot = FindPivot(column, row);
+      if (pivot == -1)
+        continue;
+      if (pivot != row)
+        SwapRows(row, pivot, first, last);
+      swaps.push_back(pivot);
+      double pivotVal = column[row];
+      for (int y = row + 1; y < height; ++y)
+        column[y] /= pivotVal;
+      for (int xx = x + 1; xx < last; ++xx)
+      {
+        double * col = lu.Column(xx);
+        double factor = col[row];
+        if (factor == 0)
+          continue;
+        for (int y = row + 1; y < height; ++y)
+          col[y] -= column[y] * factor;
+      }
+      pivotColumns.push_back(x);
+      row++;
+    }
+    // Swaps go through the columns left of the panel one column at a time instead of along the rows
+    for (int x = 0; x < first; ++x)
+    {
+      double * column = lu.Column(x);
+      for (size_t i = 0; i < swaps.size(); ++i)
+        if (swaps[i] != firstRow + (int) i)
+          SwapInColumn(column, firstRow + i, swaps[i]);
+    }
+    if (row > firstRow && last < width)
+      UpdateTrailing(firstRow, last, firstPivot, swaps, pool);
+  }
+}
+
+void LUDecomposition::UpdateTrailing(int firstRow, int firstColumn, int pivots, const std::vector<int>& swaps,
+                                     ThreadPool * pool)
+{
+  int height = lu.GetHeight();
+  int ld = lu.GetLeadingDimension();
+  int count = pivotColumns.size() - pivots;
+  int lastRow = firstRow + count;
+  int n = lu.GetWidth() - firstColumn;
+  std::vector<const double *> l(count);
+  for (int k = 0; k < count; ++k)
+    l[k] = lu.Column(pivotColumns[pivots + k]);
+
+  // Pivot rows of the trailing columns: U12 = L11^-1 * A12, every column on its own after its swaps
+  int parts = 1;
+  if (pool && (long) n * count * count >= PARALLELTHRESHOLD)
+    parts = std::min(n, pool->GetThreadCount());
+  auto solve = [&](int part)
+  {
+    for (int x = firstColumn + (long) n * part / parts; x < firstColumn + (long) n * (part + 1) / parts; ++x)
+    {
+      double * column = lu.Column(x);
+      for (int k = 0; k < count; ++k)
+        if (swaps[k] != firstRow + k)
+          SwapInColumn(column, firstRow + k, swaps[k]);
+      for (int k = 0; k < count; ++k)
+      {
+        double val = column[firstRow + k];
+        if (val != 0)
+          for (int i = k + 1; i < count; ++i)
+            column[firstRow + i] -= l[k][firstRow + i] * val;
+      }
+    }
+  };
+  if (pool)
+    pool->Run(parts, solve);
+  else
+    solve(0);
+
+  // Rows below: A22 -= L21 * U12, with L21 gathered, because skipped columns may lie between pivot columns
+  int m = height - lastRow;
+  if (m == 0)
+    return;
+  std::vector<double> l21((size_t) m * count);
+  for (int k = 0; k < count; ++k)
+    std::copy(l[k] + lastRow, l[k] + height, l21.begin() + (size_t) k * m);
+  double * u12 = lu.Column(firstColumn) + firstRow;
+  Gemm::Multiply(m, n, count, -1, l21.data(), m, u12, ld, 1, u12 + count, ld, pool);
+}
+
+int LUDecomposition::GetRank() const
+{
+  double epsilon = std::numeric_limits<double>::epsilon() * std::max(lu.GetWidth(), lu.GetHeight());
+  int rank = 0;
+  for (size_t i = 0; i < pivotColumns.size(); ++i)
+    if (std::fabs(lu.At(pivotColumns[i], i)) > epsilon * columnScales[pivotColumns[i]])
+      rank++;
+  return rank;
+}
+
+bool LUDecomposition::IsSquare() const
+{
+  return lu.GetWidth() == lu.GetHeight();
+}
+
+bool LUDecomposition::IsInvertible() const
+{
+  return IsSquare() && GetRank() == lu.GetWidth();
+}
+
+double LUDecomposition::Determinant() const
+{
+  if (!IsInvertible())
+    return 0;
+  double determinant = sign;
+  for (int i = 0; i < lu.GetWidth(); ++i)
+    determinant *= lu.At(i, i);
+  return determinant;
+}
+
+void LUDecomposition::Solve(double * b, int ldb, int nrhs, ThreadPool * pool) const
+{
+  if (!IsInvertible())
+    std::__throw_invalid_argument("Matrix isn't invertible!");
+  int size = lu.GetWidth();
+  int parts = 1;
+  if (pool && (long) size * size * nrhs >= PARALLELTHRESHOLD)
+    parts = std::min(nrhs, pool->GetThreadCount());
+  auto solve = [&](int part)
+  {
+    std::vector<double> permuted(size);
+    for (int j = (long) nrhs * part / parts; j < (long) nrhs * (part + 1) / parts; ++j)
+    {
+      double * rhs = b + (size_t) j * ldb;
+      for (int i = 0; i < size; ++i)
+        permuted[i] = rowSigns[i] * rhs[perm[i]];
+      // L * y = P * b, column by column
+      for (int x = 0; x < size; ++x)
+      {
+        const double * column = lu.Column(x);
+        double val = permuted[x];
+        if (val != 0)
+          for (int y = x + 1; y < size; ++y)
+            permuted[y] -= column[y] * val;
+      }
+      // U * x = y
+      for (int x = size - 1; x >= 0; --x)
+      {
+        const double * column = lu.Column(x);
+        permuted[x] /= column[x];
+        double val = permuted[x];
+        if (val != 0)
+          for (int y = 0; y < x; ++y)
+            permuted[y] -= column[y] * val;
+      }
+      std::copy(permuted.begin(), permuted.end(), rhs);
+    }
+  };
+  if (pool)
+    pool->Run(parts, solve);
+  else
+    solve(0);
+}
+
+DenseMatrix * LUDecomposition::Echelon() const
+{
+  int width = lu.GetWidth();
+  int height = lu.GetHeight();
+  DenseMatrix * echelon = new DenseMatrix(width, height);
+  lu.CopyTo(echelon->Data(), echelon->GetLeadingDimension());
+  // Below the pivots are the multipliers of L and what was taken as zero
+  size_t pivot = 0;
+  for (int x = 0; x < width; ++x)
+  {
+    if (pivot < pivotColumns.size() && pivotColumns[pivot] == x)
+      pivot++;
+    double * column = echelon->Column(x);
+    std::fill(column + std::min<size_t>(pivot, height), column + height, 0.0);
+  }
+  return echelon;
+}
+
+DenseMatrix * LUDecomposition::Inverse(ThreadPool * pool) const
+{
+  if (!IsSquare())
+    std::__throw_invalid_argument("Not a square matrix!");
+  if (!IsInvertible())
+    std::__throw_invalid_argument("Matrix isn't invertible!");
+  int size = lu.GetWidth();
+  DenseMatrix * inverse = new DenseMatrix(size, size);
+  for (int i = 0; i < size; ++i)
+    inverse->SetAt(i, i, 1);
+  Solve(inverse->Data(), inverse->GetLeadingDimension(), size, pool);
+  return inverse;
+}
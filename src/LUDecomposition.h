@@ -0,0 +1,147 @@
+/**
+* @file         LUDecomposition.h
+* @date         18.10.2026
+* @brief        Definition of the LUDecomposition
+* @author       miklilad
+*/
+#ifndef SEM_LUDECOMPOSITION_H
+#define SEM_LUDECOMPOSITION_H
+
+#include <vector>
+#include "DenseMatrix.h"
+#include "ThreadPool.h"
+
+/**
+* @class    LUDecomposition
+* @brief    LU factorization with row pivoting, P * A = L * U
+* @details  Works for any shape. Columns without a usable pivot are skipped, so U is in row echelon
+* @details  form and the number of pivots is the rank. L (unit lower triangular, diagonal not stored)
+* @details  and U share one column-major buffer. Row i of the factors is row perm[i] of A
+* @details  multiplied by rowSigns[i].
+* @details  Elimination is blocked: a panel of BLOCK columns is eliminated row by row, then the rest
+* @details  of the pivot rows is solved by L of the panel and the trailing matrix is updated by one
+* @details  GEMM, which is split between the threads of the pool.
+*/
+class LUDecomposition
+{
+public:
+  /**
+  * @enum     Pivoting
+  * @brief    How pivots are chosen and rows swapped
+  * @details  PARTIAL - largest absolute value, rows are swapped, used for rank, determinant, inverse and solve
+  * @details  GEM - closest number to zero excluding zero, the row moved down is negated,
+  * @details  same as the Calculator::GEM steps, so that the determinant doesn't change sign,
+  * @details  used only for the echelon form printed by gem
+  */
+  enum Pivoting
+  {
+    PARTIAL, GEM
+  };
+
+  /**
+  * Number of columns eliminated in one panel
+  */
+  static const int BLOCK = 96;
+
+  /**
+  * Smallest number of multiply-adds of the triangular solves worth splitting between threads
+  */
+  static const long PARALLELTHRESHOLD = 1L << 18;
+
+private:
+  DenseMatrix lu;
+  std::vector<int> perm;
+  std::vector<int> rowSigns;
+  std::vector<int> pivotColumns;
+  std::vector<double> columnScales;
+  int sign;
+  Pivoting pivoting;
+
+  /**
+  * @fn        Factorize
+  * @brief     Eliminates lu in place
+  * @details   Only exact zeroes are skipped, same as in Calculator::GEM, tiny pivots are judged by GetRank.
+  */
+  void Factorize(ThreadPool * pool);
+
+  /**
+  * @fn        FindPivot
+  * @returns   Row of the pivot in column from row start or -1, if there isn't any
+  */
+  int FindPivot(const double * column, int start) const;
+
+  /**
+  * @fn        SwapRows
+  * @brief     Swaps 2 rows in columns first .. last - 1 and records the swap
+  */
+  void SwapRows(int row1, int row2, int first, int last);
+
+  /**
+  * @fn        SwapInColumn
+  * @brief     Swaps 2 elements of a column, the one moved to row2 is negated with GEM pivoting
+  */
+  void SwapInColumn(double * column, int row1, int row2) const;
+
+  /**
+  * @fn        UpdateTrailing
+  * @brief     Applies pivots of the panel to the columns right of it
+  * @param     firstRow - Row of the first pivot in the panel
+  * @param     firstColumn - First column right of the panel
+  * @param     pivots - Index of the first pivot of the panel in pivotColumns
+  * @param     swaps - Row swapped with every pivot row of the panel
+  */
+  void UpdateTrailing(int firstRow, int firstColumn, int pivots, const std::vector<int>& swaps, ThreadPool * pool);
+
+public:
+  explicit LUDecomposition(const Matrix& m, Pivoting pivoting = PARTIAL, ThreadPool * pool = nullptr);
+
+  /**
+  * @fn        GetRank
+  * @returns   Number of pivots, which aren't negligible against the largest element of their column of A
+  * @details   Pivots up to max(width, height) * epsilon times that element are taken as rounding errors
+  * @details   of a zero. IsInvertible, Determinant, Solve and Inverse follow this numerical rank.
+  */
+  int GetRank() const;
+
+  /**
+  * @fn        IsSquare
+  * @returns   True, if the factorized matrix is square
+  */
+  bool IsSquare() const;
+
+  /**
+  * @fn        IsInvertible
+  * @returns   True, if the factorized matrix is square and has full numerical rank (see GetRank)
+  */
+  bool IsInvertible() const;
+
+  /**
+  * @fn        Determinant
+  * @returns   Determinant of the factorized square matrix
+  */
+  double Determinant() const;
+
+  /**
+  * @fn        Echelon
+  * @returns   Pointer to new matrix U, the row echelon form of the factorized matrix
+  */
+  DenseMatrix * Echelon() const;
+
+  /**
+  * @fn        Solve
+  * @brief     Overwrites columns of B by solution of A * X = B
+  * @param     b, ldb - Column-major buffer of B with nrhs columns and distance between them
+  * @param     pool - Workers to split the columns of B among, nullptr to run in the calling thread
+  * @details   Only for invertible matricies. Every column is solved by forward and back substitution.
+  */
+  void Solve(double * b, int ldb, int nrhs, ThreadPool * pool = nullptr) const;
+
+  /**
+  * @fn        Inverse
+  * @returns   Pointer to inverse matrix of the invertible factorized matrix
+  */
+  DenseMatrix * Inverse(ThreadPool * pool = nullptr) const;
+};
+
+
+#endif
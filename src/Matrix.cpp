@@ -67,3 +67,71 @@ void Matrix::ScalarMul(double num)
     for (int y = 0; y < height; ++y)
       SetAt(x, y, num * At(x, y));
 }
+
+void Matrix::CopyTo(double * buffer, int ld) const
+{
+  for (int x = 0; x < width; ++x)
+    CopyColumnTo(x, buffer + (long) x * ld);
+}
+
+void Matrix::FillFrom(const double * buffer, int ld)
+{
+  for (int x = 0; x < width; ++x)
+    for (int y = 0; y < height; ++y)
+      SetAt(x, y, buffer[(long) x * ld + y]);
+}
+
+void Matrix::CopyRowTo(int y, double * buffer) const
+{
+  for (int x = 0; x < width; ++x)
+    buffer[x] = At(x, y);
+}
+
+void Matrix::CopyColumnTo(int x, double * buffer) const
+{
+  for (int y = 0; y < height; ++y)
+    buffer[y] = At(x, y);
+}
+
+long long Matrix::GetNonZeroCount() const
+{
+  long long count = 0;
+  for (NonZeroIterator it(*this); it.Next();)
+    count++;
+  return count;
+}
+
+long long Matrix::ReadNonZeros(long long cursor, Entry * out, int max, int& count) const
+{
+  long long size = (long long) width * height;
+  count = 0;
+  while (cursor < size && count < max)
+  {
+    int x = cursor / height;
+    int y = cursor % height;
+    double val = At(x, y);
+    if (val != 0)
+      out[count++] = {x, y, val};
+    cursor++;
+  }
+  return cursor < size ? cursor : -1;
+}
+
+Matrix::NonZeroIterator::NonZeroIterator(const Matrix& m) : m(m), count(0), pos(0), cursor(0)
+{
+
+}
+
+bool Matrix::NonZeroIterator::Next()
+{
+  if (++pos < count)
+    return true;
+  while (cursor != -1)
+  {
+    cursor = m.ReadNonZeros(cursor, batch, BATCH, count);
+    pos = 0;
+    if (count > 0)
+      return true;
+  }
+  return false;
+}
@@ -10,6 +10,10 @@
 /**
 * @class    Matrix
 * @brief    Mathematical object
+* @details  At and SetAt are meant for single elements. Whole-matrix operations should use
+* @details  the bulk methods (CopyTo, FillFrom, CopyRowTo, CopyColumnTo, NonZeroIterator), which
+* @details  cost one virtual call per row, column or batch of elements, or dispatch once on the
+* @details  concrete storage and use its raw accessors.
 */
 class Matrix
 {
@@ -18,6 +22,71 @@ protected:
   int height;
 
 public:
+  /**
+  * @struct   Entry
+  * @brief    Single stored element of the matrix
+  */
+  struct Entry
+  {
+    int x, y;
+    double val;
+  };
+
+  /**
+  * @struct   BasicSpan
+  * @brief    View of size elements, which are stride elements apart
+  */
+  template<typename T>
+  struct BasicSpan
+  {
+    T * data;
+    int size;
+    int stride;
+
+    T& operator[](int i) const
+    {
+      return data[(long) i * stride];
+    }
+  };
+
+  typedef BasicSpan<double> Span;
+  typedef BasicSpan<const double> ConstSpan;
+
+  /**
+  * @class    NonZeroIterator
+  * @brief    Iterates over the nonzero elements of a matrix
+  * @details  Elements are fetched from the matrix in batches by ReadNonZeros.
+  * @details  Usage: for (Matrix::NonZeroIterator it(m); it.Next();) it.Get()...
+  */
+  class NonZeroIterator
+  {
+    static const int BATCH = 256;
+    const Matrix& m;
+    Entry batch[BATCH];
+    int count;
+    int pos;
+    long long cursor;
+
+  public:
+    explicit NonZeroIterator(const Matrix& m);
+
+    /**
+    * @fn        Next
+    * @brief     Moves to the next nonzero element
+    * @returns   False, if there are no more elements
+    */
+    bool Next();
+
+    /**
+    * @fn        Get
+    * @returns   Current element
+    */
+    const Entry& Get() const
+    {
+      return batch[pos];
+    }
+  };
+
   Matrix(int width, int height);
 
   /**
@@ -47,20 +116,65 @@ public:
   /**
   * @fn        GetCopy
   * @returns   Copy of the matrix
+  * @details   DenseMatrix and SparseMatrix copies share the storage, until one of them is modified.
   */
   virtual Matrix * GetCopy() const;
 
   /**
   * @fn        SwapRows
   * @brief     Swaps 2 rows in the matrix
+  * @details   The row moved to row2 is negated, so that the determinant is kept.
   */
-  void SwapRows(int row1, int row2);
+  virtual void SwapRows(int row1, int row2);
 
   /**
   * @fn        ScalarMul
   * @brief     Multiplies the matrix by given scalar
   */
-  void ScalarMul(double num);
+  virtual void ScalarMul(double num);
+
+  /**
+  * @fn        CopyTo
+  * @brief     Writes the whole matrix to column-major buffer
+  * @param     ld - Distance between two columns in buffer, at least height
+  * @details   Element x,y is written to buffer[x * ld + y].
+  */
+  virtual void CopyTo(double * buffer, int ld) const;
+
+  /**
+  * @fn        FillFrom
+  * @brief     Replaces the whole matrix by contents of column-major buffer
+  * @param     ld - Distance between two columns in buffer, at least height
+  */
+  virtual void FillFrom(const double * buffer, int ld);
+
+  /**
+  * @fn        CopyRowTo
+  * @brief     Writes width elements of row y to buffer
+  */
+  virtual void CopyRowTo(int y, double * buffer) const;
+
+  /**
+  * @fn        CopyColumnTo
+  * @brief     Writes height elements of column x to buffer
+  */
+  virtual void CopyColumnTo(int x, double * buffer) const;
+
+  /**
+  * @fn        GetNonZeroCount
+  * @returns   Number of stored nonzero elements
+  */
+  virtual long long GetNonZeroCount() const;
+
+  /**
+  * @fn        ReadNonZeros
+  * @brief     Reads up to max nonzero elements starting at cursor to out
+  * @param     cursor - Position returned by previous call, 0 to start from the beginning
+  * @param     count - Number of elements written to out
+  * @returns   Cursor of the next batch or -1, if the whole matrix was read
+  * @details   Storage specific, use NonZeroIterator instead.
+  */
+  virtual long long ReadNonZeros(long long cursor, Entry * out, int max, int& count) const;
 
   /**
   * @fn        SameSize
@@ -71,6 +185,7 @@ public:
   /**
   * @fn        Transpose
   * @brief     Transposes the matrix
+  * @details   DenseMatrix and SparseMatrix only mark their storage as transposed in O(1).
   */
   virtual void Transpose();
 
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <typeinfo>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MatrixFile.h"
+
+const uint32_t MatrixFile::VERSION;
+
+const char MAGIC[8] = {'M', 'T', 'X', 'C', 'A', 'L', 'C', '\0'};
+const size_t BLOCK = 64;
+const uint64_t FNVBASIS = 14695981039346656037ULL;
+const uint64_t FNVPRIME = 1099511628211ULL;
+
+MatrixFile::Checksum::Checksum() : lanes{FNVBASIS, FNVBASIS + 1, FNVBASIS + 2, FNVBASIS + 3}, index(0)
+{
+
+}
+
+void MatrixFile::Checksum::Update(const void * data, size_t bytes)
+{
+  const unsigned char * input = static_cast<const unsigned char *>(data);
+  size_t words = bytes / sizeof(uint64_t);
+  size_t i = 0;
+  uint64_t word;
+  for (; i < words && (index + i) % 4 != 0; ++i)
+  {
+    std::memcpy(&word, input + i * sizeof(word), sizeof(word));
+    uint64_t& lane = lanes[(index + i) % 4];
+    lane = (lane ^ word) * FNVPRIME;
+  }
+  for (; i + 4 <= words; i += 4)
+    for (int j = 0; j < 4; ++j)
+    {
+      std::memcpy(&word, input + (i + j) * sizeof(word), sizeof(word));
+      lanes[j] = (lanes[j] ^ word) * FNVPRIME;
+    }
+  for (; i < words; ++i)
+  {
+    std::memcpy(&word, input + i * sizeof(word), sizeof(word));
+    uint64_t& lane = lanes[(index + i) % 4];
+    lane = (lane ^ word) * FNVPRIME;
+  }
+  index += words;
+}
+
+uint64_t MatrixFile::Checksum::Get() const
+{
+  uint64_t hash = FNVBASIS;
+  for (uint64_t lane:lanes)
+    hash = (hash ^ lane) * FNVPRIME;
+  return (hash ^ index) * FNVPRIME;
+}
+
+size_t MatrixFile::Padded(size_t bytes)
+{
+  return (bytes + BLOCK - 1) / BLOCK * BLOCK;
+}
+
+void MatrixFile::Write(std::FILE * file, const void * data, size_t bytes, Checksum& checksum)
+{
+  // whole blocks are written directly, the rest is padded in a block of zeroes
+  size_t whole = bytes / BLOCK * BLOCK;
+  if (std::fwrite(data, 1, whole, file) != whole)
+    std::__throw_invalid_argument("Cannot write the file!");
+  checksum.Update(data, whole);
+  if (whole == bytes)
+    return;
+  unsigned char last[BLOCK] = {};
+  std::memcpy(last, static_cast<const unsigned char *>(data) + whole, bytes - whole);
+  if (std::fwrite(last, 1, BLOCK, file) != BLOCK)
+    std::__throw_invalid_argument("Cannot write the file!");
+  checksum.Update(last, BLOCK);
+}
+
+void MatrixFile::SaveDense(std::FILE * file, const Matrix& m, Header& header, Checksum& checksum)
+{
+  int perBlock = BLOCK / sizeof(double);
+  int ld = (m.GetHeight() + perBlock - 1) / perBlock * perBlock;
+  std::vector<double> column(ld, 0.0);
+  for (int x = 0; x < m.GetWidth(); ++x)
+  {
+    m.CopyColumnTo(x, column.data());
+    Write(file, column.data(), column.size() * sizeof(double), checksum);
+  }
+  header.ld = ld;
+}
+
+void MatrixFile::SaveSparse(std::FILE * file, const SparseMatrix& m, Header& header, Checksum& checksum)
+{
+  long long nnz = m.GetNonZeroCount();
+  Write(file, m.GetRowPointers(), (m.GetHeight() + 1) * sizeof(int), checksum);
+  Write(file, m.GetColumnIndices(), nnz * sizeof(int), checksum);
+  Write(file, m.GetValues(), nnz * sizeof(double), checksum);
+  header.nnz = nnz;
+}
+
+void MatrixFile::Save(const Matrix& m, const std::string& path)
+{
+  std::unique_ptr<std::FILE, int (*)(std::FILE *)> file(std::fopen(path.c_str(), "wb"), std::fclose);
+  if (!file)
+    std::__throw_invalid_argument("Cannot open the file!");
+  Header header = {};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.width = m.GetWidth();
+  header.height = m.GetHeight();
+  // payload is written first, the header with its checksum is filled in afterwards
+  if (std::fseek(file.get(), sizeof(Header), SEEK_SET) != 0)
+    std::__throw_invalid_argument("Cannot write the file!");
+  Checksum checksum;
+  if (typeid(SparseMatrix) == typeid(m))
+  {
+    header.kind = SPARSE;
+    SaveSparse(file.get(), static_cast<const SparseMatrix&>(m), header, checksum);
+  }
+  else
+  {
+    header.kind = DENSE;
+    SaveDense(file.get(), m, header, checksum);
+  }
+  header.checksum = checksum.Get();
+  Checksum headerChecksum;
+  headerChecksum.Update(&header, offsetof(Header, headerChecksum));
+  header.headerChecksum = headerChecksum.Get();
+  if (std::fseek(file.get(), 0, SEEK_SET) != 0 || std::fwrite(&header, sizeof(Header), 1, file.get()) != 1 ||
+      std::fflush(file.get()) != 0)
+    std::__throw_invalid_argument("Cannot write the file!");
+}
+
+uint64_t MatrixFile::PayloadSize(const Header& header)
+{
+  if (header.kind == DENSE)
+    return (uint64_t) header.width * header.ld * sizeof(double);
+  return Padded((header.height + 1) * sizeof(int)) + Padded(header.nnz * sizeof(int)) +
+         Padded(header.nnz * sizeof(double));
+}
+
+void MatrixFile::CheckHeader(const Header& header, uint64_t fileSize)
+{
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+    std::__throw_invalid_argument("Not a matrix file!");
+  Checksum checksum;
+  checksum.Update(&header, offsetof(Header, headerChecksum));
+  if (checksum.Get() != header.headerChecksum)
+    std::__throw_invalid_argument("Corrupted file!");
+  if (header.version != VERSION)
+    std::__throw_invalid_argument("Unsupported version of the file!");
+  if ((header.kind != DENSE && header.kind != SPARSE) || header.width < 1 || header.height < 1 ||
+      header.width > INT_MAX || header.height >= INT_MAX)
+    std::__throw_invalid_argument("Corrupted file!");
+  if (header.kind == DENSE &&
+      (header.ld < header.height || header.ld > INT_MAX || header.ld % (BLOCK / sizeof(double)) != 0))
+    std::__throw_invalid_argument("Corrupted file!");
+  if (header.kind == DENSE && (uint64_t) header.width * header.ld > (uint64_t) INT64_MAX / sizeof(double))
+    std::__throw_invalid_argument("Corrupted file!");
+  if (header.kind == SPARSE && (header.nnz < 0 || header.nnz > INT_MAX))
+    std::__throw_invalid_argument("Corrupted file!");
+  if (fileSize != sizeof(Header) + PayloadSize(header))
+    std::__throw_invalid_argument("Corrupted file!");
+}
+
+SparseMatrix * MatrixFile::LoadSparse(const Header& header, const unsigned char * payload)
+{
+  int width = header.width;
+  int height = header.height;
+  int nnz = header.nnz;
+  const int * rowPtr = reinterpret_cast<const int *>(payload);
+  payload += Padded((height + 1) * sizeof(int));
+  const int * colIdx = reinterpret_cast<const int *>(payload);
+  payload += Padded(nnz * sizeof(int));
+  const double * values = reinterpret_cast<const double *>(payload);
+  // indices are checked, SparseMatrix relies on sorted columns within bounds
+  if (rowPtr[0] != 0 || rowPtr[height] != nnz)
+    std::__throw_invalid_argument("Corrupted file!");
+  for (int y = 0; y < height; ++y)
+  {
+    if (rowPtr[y + 1] < rowPtr[y] || rowPtr[y + 1] > nnz)
+      std::__throw_invalid_argument("Corrupted file!");
+    for (int i = rowPtr[y]; i < rowPtr[y + 1]; ++i)
+      if (colIdx[i] < 0 || colIdx[i] >= width || (i > rowPtr[y] && colIdx[i] <= colIdx[i - 1]))
+        std::__throw_invalid_argument("Corrupted file!");
+  }
+  return new SparseMatrix(width, height, std::vector<int>(rowPtr, rowPtr + height + 1),
+                          std::vector<int>(colIdx, colIdx + nnz), std::vector<double>(values, values + nnz));
+}
+
+Matrix * MatrixFile::Load(const std::string& path, bool verify)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1)
+    std::__throw_invalid_argument("Cannot open the file!");
+  struct stat info;
+  Header header;
+  if (fstat(fd, &info) != 0 || info.st_size < (off_t) sizeof(Header) ||
+      pread(fd, &header, sizeof(Header), 0) != (ssize_t) sizeof(Header))
+  {
+    close(fd);
+    std::__throw_invalid_argument("Not a matrix file!");
+  }
+  try
+  {
+    CheckHeader(header, info.st_size);
+  }
+  catch (...)
+  {
+    close(fd);
+    throw;
+  }
+  // private writable mapping: modified pages are copied by the kernel, the file stays as it is
+  size_t length = info.st_size;
+  void * mapped = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED)
+    std::__throw_invalid_argument("Cannot map the file!");
+  std::shared_ptr<void> mapping(mapped, [length](void * address)
+  {
+    munmap(address, length);
+  });
+  const unsigned char * payload = static_cast<const unsigned char *>(mapped) + sizeof(Header);
+  if (verify)
+  {
+    Checksum checksum;
+    checksum.Update(payload, length - sizeof(Header));
+    if (checksum.Get() != header.checksum)
+      std::__throw_invalid_argument("Checksum doesn't match!");
+  }
+  if (header.kind == SPARSE)
+  {
+    madvise(mapped, length, MADV_SEQUENTIAL);
+    return LoadSparse(header, payload);
+  }
+  // the buffer keeps the mapping alive, it's unmapped with the last matrix using it
+  double * buffer = reinterpret_cast<double *>(static_cast<unsigned char *>(mapped) + sizeof(Header));
+  return new DenseMatrix(header.width, header.height, std::shared_ptr<double>(mapping, buffer), header.ld);
+}
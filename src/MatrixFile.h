@@ -0,0 +1,150 @@
+/**
+* @file         MatrixFile.h
+* @date         18.10.2026
+* @brief        Definition of the MatrixFile
+* @author       miklilad
+*/
+#ifndef SEM_MATRIXFILE_H
+#define SEM_MATRIXFILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "Matrix.h"
+#include "DenseMatrix.h"
+#include "SparseMatrix.h"
+
+/**
+* @class    MatrixFile
+* @brief    Binary file format of matricies
+* @details  File starts with 64-byte Header followed by the payload, both in native byte order.
+* @details  Dense payload are the columns of the matrix, each padded by zeroes to ld doubles,
+* @details  so that it can be used as the buffer of DenseMatrix. Sparse payload are CSR arrays rowPtr
+* @details  (height + 1 ints), colIdx (nnz ints) and values (nnz doubles), each padded to 64 bytes.
+* @details  Every part of the file starts at a multiple of 64 bytes. Dense files are mapped to memory
+* @details  on load and the mapping becomes the buffer of the matrix, nothing is read until it's used.
+* @details  Errors are reported by std::invalid_argument.
+*/
+class MatrixFile
+{
+public:
+  /**
+  * Version written to new files, files of other versions are rejected
+  */
+  static const uint32_t VERSION = 1;
+
+  /**
+  * @enum     Kind
+  * @brief    Layout of the payload
+  */
+  enum Kind
+  {
+    DENSE = 1, SPARSE
+  };
+
+  /**
+  * @fn        Save
+  * @brief     Writes m to the file at path, which is overwritten
+  * @details   SparseMatrix is saved as sparse, any other matrix as dense.
+  */
+  static void Save(const Matrix& m, const std::string& path);
+
+  /**
+  * @fn        Load
+  * @brief     Reads a matrix from the file at path
+  * @param     verify - Compare the checksum of the payload, which reads the whole file
+  * @details   Header is always checked. Dense matrix is backed by a private mapping of the file,
+  * @details   pages are read on first access and copied on write, the file itself is never changed.
+  * @returns   Pointer to the new matrix
+  */
+  static Matrix * Load(const std::string& path, bool verify = false);
+
+private:
+  /**
+  * @struct   Header
+  * @brief    First 64 bytes of the file
+  * @details   checksum covers the payload, headerChecksum the fields before it.
+  */
+  struct Header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t kind;
+    int64_t width;
+    int64_t height;
+    int64_t ld;
+    int64_t nnz;
+    uint64_t checksum;
+    uint64_t headerChecksum;
+  };
+
+  /**
+  * @class    Checksum
+  * @brief    FNV-1a over 64-bit words, interleaved in 4 independent lanes to keep up with memory
+  */
+  class Checksum
+  {
+    uint64_t lanes[4];
+    size_t index;
+
+  public:
+    Checksum();
+
+    /**
+    * @fn        Update
+    * @brief     Adds bytes, whose count is a multiple of 8
+    */
+    void Update(const void * data, size_t bytes);
+
+    /**
+    * @fn        Get
+    * @returns   Checksum of all bytes added so far
+    */
+    uint64_t Get() const;
+  };
+
+  /**
+  * @fn        Padded
+  * @returns   Bytes rounded up to the whole 64-byte block
+  */
+  static size_t Padded(size_t bytes);
+
+  /**
+  * @fn        Write
+  * @brief     Writes bytes and zeroes up to Padded(bytes) and adds them to checksum
+  */
+  static void Write(std::FILE * file, const void * data, size_t bytes, Checksum& checksum);
+
+  /**
+  * @fn        SaveDense
+  * @brief     Writes the payload of dense m, fills ld in header
+  */
+  static void SaveDense(std::FILE * file, const Matrix& m, Header& header, Checksum& checksum);
+
+  /**
+  * @fn        SaveSparse
+  * @brief     Writes the payload of m, fills nnz in header
+  */
+  static void SaveSparse(std::FILE * file, const SparseMatrix& m, Header& header, Checksum& checksum);
+
+  /**
+  * @fn        PayloadSize
+  * @returns   Size of the payload described by header
+  */
+  static uint64_t PayloadSize(const Header& header);
+
+  /**
+  * @fn        CheckHeader
+  * @brief     Throws std::invalid_argument, if header isn't valid or doesn't match the size of the file
+  */
+  static void CheckHeader(const Header& header, uint64_t fileSize);
+
+  /**
+  * @fn        LoadSparse
+  * @brief     Copies the CSR arrays from payload and checks, that they describe a valid matrix
+  */
+  static SparseMatrix * LoadSparse(const Header& header, const unsigned char * payload);
+};
+
+
+#endif
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <typeinfo>
+#include "MatrixPrinter.h"
+#include "SparseMatrix.h"
+
+const int MatrixPrinter::MAXLENGTH;
+
+const size_t BLOCKSIZE = 1 << 16;
+
+MatrixPrinter::MatrixPrinter(std::ostream& os, int limit, int edge) : os(os), limit(limit), edge(edge)
+{
+
+}
+
+void MatrixPrinter::SetLimit(int limit, int edge)
+{
+  this->limit = limit;
+  this->edge = edge;
+}
+
+int MatrixPrinter::GetLimit() const
+{
+  return limit;
+}
+
+int MatrixPrinter::GetEdge() const
+{
+  return edge;
+}
+
+int MatrixPrinter::Format(double val, char * text)
+{
+  // ostream prints doubles with %g and precision 6 by default
+  char buffer[MAXLENGTH + 1];
+  int length = std::snprintf(buffer, sizeof(buffer), "%g", val);
+  std::copy(buffer, buffer + length, text);
+  return length;
+}
+
+std::vector<int> MatrixPrinter::Shown(int size, bool whole) const
+{
+  std::vector<int> shown;
+  if (whole || limit == 0 || size <= limit)
+  {
+    for (int i = 0; i < size; ++i)
+      shown.push_back(i);
+    return shown;
+  }
+  for (int i = 0; i < edge; ++i)
+    shown.push_back(i);
+  shown.push_back(-1);
+  for (int i = size - edge; i < size; ++i)
+    shown.push_back(i);
+  return shown;
+}
+
+void MatrixPrinter::Write(int count, const char * value, int length)
+{
+  if (count < 0 || length < 0)
+    throw std::exception();
+  out.append(count, ' ');
+  out.append(value, length);
+  if (out.size() >= BLOCKSIZE)
+    Flush();
+}
+
+void MatrixPrinter::Flush()
+{
+  os.write(out.data(), out.size());
+  out.clear();
+}
+
+void MatrixPrinter::Print(const Matrix& m, Mode mode)
+{
+  bool over = limit != 0 && (m.GetWidth() > limit || m.GetHeight() > limit);
+  if (mode == NONZEROS || (mode == AUTO && over && typeid(SparseMatrix) == typeid(m)))
+  {
+    PrintNonZeros(m);
+    return;
+  }
+  std::vector<int> rows = Shown(m.GetHeight(), mode == WHOLE);
+  std::vector<int> columns = Shown(m.GetWidth(), mode == WHOLE);
+  int rowCount = rows.size() - std::count(rows.begin(), rows.end(), -1);
+  // "..." of an omitted row is printed in every column, so no column is narrower
+  int minWidth = rowCount != (int) rows.size() ? 3 : 0;
+  // values are formatted column by column, the texts of a column follow each other in text
+  std::vector<double> column(m.GetHeight());
+  std::vector<int> widths(columns.size(), 3);
+  std::vector<size_t> offsets(columns.size(), 0);
+  text.clear();
+  lengths.clear();
+  char value[MAXLENGTH];
+  for (size_t c = 0; c < columns.size(); ++c)
+  {
+    offsets[c] = text.size();
+    if (columns[c] == -1)
+      continue;
+    widths[c] = minWidth;
+    m.CopyColumnTo(columns[c], column.data());
+    for (int y:rows)
+    {
+      if (y == -1)
+        continue;
+      int length = Format(column[y], value);
+      text.append(value, length);
+      lengths.push_back(length);
+      widths[c] = std::max(widths[c], length);
+    }
+  }
+  std::vector<size_t> next(offsets);
+  std::vector<size_t> index(columns.size());
+  for (size_t c = 0, filled = 0; c < columns.size(); ++c)
+  {
+    index[c] = filled * rowCount;
+    filled += columns[c] != -1;
+  }
+  for (int y:rows)
+  {
+    for (size_t c = 0; c < columns.size(); ++c)
+    {
+      if (y == -1 || columns[c] == -1)
+      {
+        Write(widths[c] + 1 - 3, "...", 3);
+        continue;
+      }
+      int length = lengths[index[c]++];
+      Write(widths[c] + 1 - length, text.data() + next[c], length);
+      next[c] += length;
+    }
+    Write(0, "\n", 1);
+  }
+  if (rows.size() != (size_t) m.GetHeight() || columns.size() != (size_t) m.GetWidth())
+  {
+    char size[2 * MAXLENGTH];
+    int length = std::snprintf(size, sizeof(size), "[%d x %d]\n", m.GetHeight(), m.GetWidth());
+    Write(0, size, length);
+  }
+  Flush();
+}
+
+void MatrixPrinter::PrintNonZeros(const Matrix& m)
+{
+  char position[2 * MAXLENGTH];
+  char value[MAXLENGTH];
+  long long count = 0;
+  for (Matrix::NonZeroIterator it(m); it.Next(); ++count)
+  {
+    if (limit != 0 && count >= limit)
+      continue;
+    const Matrix::Entry& entry = it.Get();
+    int length = std::snprintf(position, sizeof(position), "(%d, %d) ", entry.y + 1, entry.x + 1);
+    Write(0, position, length);
+    Write(0, value, Format(entry.val, value));
+    Write(0, "\n", 1);
+  }
+  if (limit != 0 && count > limit)
+  {
+    int length = std::snprintf(position, sizeof(position), "... %lld more\n", count - limit);
+    Write(0, position, length);
+  }
+  int length = std::snprintf(position, sizeof(position), "[%d x %d, %lld nonzero]\n", m.GetHeight(),
+                             m.GetWidth(), count);
+  Write(0, position, length);
+  Flush();
+}
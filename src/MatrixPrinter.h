@@ -0,0 +1,119 @@
+/**
+* @file         MatrixPrinter.h
+* @date         18.10.2026
+* @brief        Definition of the MatrixPrinter
+* @author       miklilad
+*/
+#ifndef SEM_MATRIXPRINTER_H
+#define SEM_MATRIXPRINTER_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Matrix.h"
+
+/**
+* @class    MatrixPrinter
+* @brief    Prints matricies as right-aligned columns of numbers
+* @details  Each printed value is formatted once (same text as ostream with default precision)
+* @details  to a reusable buffer, while the widths of the columns are measured, so the matrix
+* @details  is read in one pass column by column. Lines are then assembled from the buffer
+* @details  and written to os in large blocks.
+* @details  Matricies with more rows or columns than the limit are summarized: only edge rows (columns)
+* @details  from each side are shown and the rest is replaced by "...". SparseMatrix over the limit
+* @details  is listed by its nonzero elements instead, of which at most limit are shown.
+*/
+class MatrixPrinter
+{
+public:
+  /**
+  * @enum     Mode
+  * @brief    AUTO - summarized over the limit, WHOLE - every element, NONZEROS - list of nonzero elements
+  */
+  enum Mode
+  {
+    AUTO, WHOLE, NONZEROS
+  };
+
+  /**
+  * Longest text of a formatted value
+  */
+  static const int MAXLENGTH = 24;
+
+private:
+  std::ostream& os;
+  int limit;
+  int edge;
+  std::string text;
+  std::vector<unsigned char> lengths;
+  std::string out;
+
+  /**
+  * @fn        Shown
+  * @brief     Indices of size rows (columns), which are printed
+  * @details   Index -1 marks the place of omitted ones.
+  */
+  std::vector<int> Shown(int size, bool whole) const;
+
+  /**
+  * @fn        Write
+  * @brief     Appends count spaces, length characters of value and flushes the block, if it's big
+  * @details   Throws std::exception, if count or length is negative.
+  */
+  void Write(int count, const char * value, int length);
+
+  /**
+  * @fn        Flush
+  * @brief     Writes the assembled block to os
+  */
+  void Flush();
+
+public:
+  /**
+  * @param     limit - Largest number of rows or columns printed whole, 0 for no limit
+  * @param     edge - Rows or columns shown from each side of a summarized matrix
+  */
+  MatrixPrinter(std::ostream& os, int limit = 100, int edge = 5);
+
+  /**
+  * @fn        SetLimit
+  * @brief     Sets limit and edge, see the constructor
+  */
+  void SetLimit(int limit, int edge);
+
+  /**
+  * @fn        GetLimit
+  * @returns   Largest number of rows or columns printed whole, 0 for no limit
+  */
+  int GetLimit() const;
+
+  /**
+  * @fn        GetEdge
+  * @returns   Rows or columns shown from each side of a summarized matrix
+  */
+  int GetEdge() const;
+
+  /**
+  * @fn        Format
+  * @brief     Writes val to text as ostream << val would, without '\\0'
+  * @param     text - Room for MAXLENGTH characters
+  * @returns   Length of the text
+  */
+  static int Format(double val, char * text);
+
+  /**
+  * @fn        Print
+  * @brief     Prints m in the given mode
+  */
+  void Print(const Matrix& m, Mode mode = AUTO);
+
+  /**
+  * @fn        PrintNonZeros
+  * @brief     Prints nonzero elements of m as "(row, column) value", rows and columns count from 1
+  * @details   At most limit elements are printed, followed by the number of the remaining ones.
+  */
+  void PrintNonZeros(const Matrix& m);
+};
+
+
+#endif
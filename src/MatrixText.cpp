@@ -0,0 +1,441 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <locale>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <typeinfo>
+#include "MatrixText.h"
+
+const size_t MatrixText::CHUNK;
+const size_t MatrixText::LOOKAHEAD;
+
+const double POWERS[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                         1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+MatrixText::Reader::Reader(std::FILE * file) : file(file), buffer(CHUNK + LOOKAHEAD), pos(0), end(0), eof(false)
+{
+
+}
+
+void MatrixText::Reader::Fill()
+{
+  if (eof || end - pos >= LOOKAHEAD)
+    return;
+  std::memmove(buffer.data(), buffer.data() + pos, end - pos);
+  end -= pos;
+  pos = 0;
+  while (!eof && end < LOOKAHEAD)
+  {
+    size_t read = std::fread(buffer.data() + end, 1, buffer.size() - end, file);
+    end += read;
+    if (read == 0)
+      eof = true;
+  }
+}
+
+int MatrixText::Reader::Peek()
+{
+  if (pos == end)
+    Fill();
+  return pos == end ? EOF : (unsigned char) buffer[pos];
+}
+
+void MatrixText::Reader::Get()
+{
+  if (Peek() != EOF)
+    pos++;
+}
+
+void MatrixText::Reader::SkipBlanks()
+{
+  int c;
+  while ((c = Peek()) == ' ' || c == '\t' || c == '\r')
+    pos++;
+}
+
+void MatrixText::Reader::SkipSpaces()
+{
+  int c;
+  while ((c = Peek()) != EOF && std::isspace(c))
+    pos++;
+}
+
+std::string MatrixText::Reader::ReadLine()
+{
+  std::string line;
+  int c;
+  while ((c = Peek()) != EOF && c != '\n')
+  {
+    line.push_back(c);
+    pos++;
+  }
+  Get();
+  if (!line.empty() && line.back() == '\r')
+    line.pop_back();
+  return line;
+}
+
+bool MatrixText::Reader::ReadDouble(double& val)
+{
+  Fill();
+  const char * text = buffer.data() + pos;
+  if (!ParseDouble(text, buffer.data() + end, val))
+    return false;
+  pos = text - buffer.data();
+  return true;
+}
+
+bool MatrixText::Reader::ReadInt(long long& val)
+{
+  Fill();
+  if (pos == end || !std::isdigit((unsigned char) buffer[pos]))
+    return false;
+  val = 0;
+  while (pos < end && std::isdigit((unsigned char) buffer[pos]))
+  {
+    val = val * 10 + (buffer[pos++] - '0');
+    if (val > INT32_MAX)
+      return false;
+  }
+  return true;
+}
+
+MatrixText::Writer::Writer(std::FILE * file) : file(file), buffer(CHUNK), pos(0)
+{
+
+}
+
+void MatrixText::Writer::Write(const char * text, size_t length)
+{
+  if (pos + length > buffer.size())
+    Flush();
+  if (length > buffer.size())
+  {
+    if (std::fwrite(text, 1, length, file) != length)
+      std::__throw_invalid_argument("Cannot write the file!");
+    return;
+  }
+  std::memcpy(buffer.data() + pos, text, length);
+  pos += length;
+}
+
+void MatrixText::Writer::Write(const std::string& text)
+{
+  Write(text.data(), text.size());
+}
+
+void MatrixText::Writer::Write(char c)
+{
+  if (pos == buffer.size())
+    Flush();
+  buffer[pos++] = c;
+}
+
+void MatrixText::Writer::WriteDouble(double val)
+{
+  if (val == 0)
+  {
+    Write('0');
+    return;
+  }
+  // 15 digits are enough for most values, 17 for every one
+  char text[32];
+  int length = std::snprintf(text, sizeof(text), "%.15g", val);
+  const char * parsed = text;
+  double back;
+  if (!ParseDouble(parsed, text + length, back) || back != val)
+    length = std::snprintf(text, sizeof(text), "%.17g", val);
+  Write(text, length);
+}
+
+void MatrixText::Writer::Flush()
+{
+  if (std::fwrite(buffer.data(), 1, pos, file) != pos)
+    std::__throw_invalid_argument("Cannot write the file!");
+  pos = 0;
+}
+
+bool MatrixText::ParseDouble(const char *& text, const char * end, double& val)
+{
+  const char * p = text;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+'))
+    negative = *p++ == '-';
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool any = false;
+  // digits beyond 19 don't fit the mantissa, they only move the exponent
+  for (; p < end && std::isdigit((unsigned char) *p); ++p)
+  {
+    any = true;
+    if (digits < 19)
+    {
+      mantissa = mantissa * 10 + (*p - '0');
+      digits += mantissa != 0;
+    }
+    else
+      exponent++;
+  }
+  if (p < end && *p == '.')
+  {
+    for (++p; p < end && std::isdigit((unsigned char) *p); ++p)
+    {
+      any = true;
+      if (digits < 19)
+      {
+        mantissa = mantissa * 10 + (*p - '0');
+        digits += mantissa != 0;
+        exponent--;
+      }
+    }
+  }
+  if (!any)
+    return false;
+  if (p < end && (*p == 'e' || *p == 'E'))
+  {
+    const char * q = p + 1;
+    bool negativeExponent = false;
+    if (q < end && (*q == '-' || *q == '+'))
+      negativeExponent = *q++ == '-';
+    if (q < end && std::isdigit((unsigned char) *q))
+    {
+      int value = 0;
+      for (; q < end && std::isdigit((unsigned char) *q); ++q)
+        value = std::min(value * 10 + (*q - '0'), 100000);
+      exponent += negativeExponent ? -value : value;
+      p = q;
+    }
+  }
+  if (mantissa == 0)
+    val = 0;
+  else if (mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+    val = exponent < 0 ? mantissa / POWERS[-exponent] : mantissa * POWERS[exponent];
+  else
+  {
+    // rare case, which needs correct rounding of the full text
+    std::istringstream iss(std::string(text, p));
+    iss.imbue(std::locale::classic());
+    if (!(iss >> val))
+      val = exponent > 0 ? HUGE_VAL : 0;
+    if (val < 0)
+      val = -val;
+  }
+  if (negative)
+    val = -val;
+  text = p;
+  return true;
+}
+
+Matrix * MatrixText::Preferred(DenseMatrix * m, long long nonZeros)
+{
+  if (!TripletBuilder::PreferSparse(m->GetWidth(), m->GetHeight(), nonZeros))
+    return m;
+  std::unique_ptr<DenseMatrix> dense(m);
+  const DenseMatrix& source = *dense;
+  SparseMatrix * sparse = new SparseMatrix(m->GetWidth(), m->GetHeight());
+  sparse->FillFrom(source.Data(), source.GetLeadingDimension());
+  return sparse;
+}
+
+Matrix * MatrixText::ImportMarket(Reader& reader, const std::string& banner)
+{
+  std::istringstream iss(banner);
+  std::string word, object, format, field, symmetry;
+  iss >> word >> object >> format >> field >> symmetry;
+  for (std::string * s:{&object, &format, &field, &symmetry})
+    std::transform(s->begin(), s->end(), s->begin(), ::tolower);
+  bool coordinate = format == "coordinate";
+  bool pattern = field == "pattern";
+  bool symmetric = symmetry == "symmetric";
+  bool skew = symmetry == "skew-symmetric";
+  if (object != "matrix" || (!coordinate && format != "array"))
+    std::__throw_invalid_argument("Unsupported Matrix Market format!");
+  if ((field != "real" && field != "integer" && field != "double" && !pattern) || (pattern && !coordinate))
+    std::__throw_invalid_argument("Unsupported Matrix Market field!");
+  if (!symmetric && !skew && symmetry != "general")
+    std::__throw_invalid_argument("Unsupported Matrix Market symmetry!");
+  // comments and empty lines precede the size line
+  reader.SkipSpaces();
+  while (reader.Peek() == '%')
+  {
+    reader.ReadLine();
+    reader.SkipSpaces();
+  }
+  long long height, width, count = 0;
+  if (!reader.ReadInt(height) || (reader.SkipBlanks(), !reader.ReadInt(width)) ||
+      (coordinate && (reader.SkipBlanks(), !reader.ReadInt(count))))
+    std::__throw_invalid_argument("Wrong size!");
+  if (width < 1 || height < 1 || ((symmetric || skew) && width != height))
+    std::__throw_invalid_argument("Wrong size!");
+  if (coordinate)
+  {
+    TripletBuilder builder(width, height);
+    builder.Reserve(symmetric || skew ? 2 * count : count);
+    for (long long i = 0; i < count; ++i)
+    {
+      long long y, x;
+      double val = 1;
+      reader.SkipSpaces();
+      if (!reader.ReadInt(y) || (reader.SkipBlanks(), !reader.ReadInt(x)) ||
+          (!pattern && (reader.SkipBlanks(), !reader.ReadDouble(val))))
+        std::__throw_invalid_argument("Wrong entry!");
+      if (y < 1 || y > height || x < 1 || x > width)
+        std::__throw_invalid_argument("Entry out of matrix bounds!");
+      builder.Add(x - 1, y - 1, val);
+      if ((symmetric || skew) && x != y)
+        builder.Add(y - 1, x - 1, skew ? -val : val);
+    }
+    return builder.Build();
+  }
+  // array holds columns, symmetric ones only from the diagonal (below it for skew-symmetric) down
+  std::unique_ptr<DenseMatrix> m(new DenseMatrix(width, height));
+  long long nonZeros = 0;
+  for (int x = 0; x < width; ++x)
+  {
+    double * column = m->Column(x);
+    int first = symmetric ? x : skew ? x + 1 : 0;
+    for (int y = first; y < height; ++y)
+    {
+      reader.SkipSpaces();
+      if (!reader.ReadDouble(column[y]))
+        std::__throw_invalid_argument("Wrong number!");
+      if (column[y] == 0)
+        continue;
+      nonZeros++;
+      if (y != x && (symmetric || skew))
+      {
+        m->Column(y)[x] = skew ? -column[y] : column[y];
+        nonZeros++;
+      }
+    }
+  }
+  return Preferred(m.release(), nonZeros);
+}
+
+Matrix * MatrixText::ImportCsv(Reader& reader)
+{
+  // rows are collected one after another, which is the transposed column-major buffer
+  std::vector<double> values;
+  long long width = -1, height = 0, nonZeros = 0;
+  while (true)
+  {
+    reader.SkipSpaces();
+    if (reader.Peek() == EOF)
+      break;
+    long long count = 0;
+    while (true)
+    {
+      double val;
+      reader.SkipBlanks();
+      if (!reader.ReadDouble(val))
+        std::__throw_invalid_argument("Wrong number!");
+      values.push_back(val);
+      nonZeros += val != 0;
+      count++;
+      reader.SkipBlanks();
+      if (reader.Peek() != ',')
+        break;
+      reader.Get();
+    }
+    if (reader.Peek() != '\n' && reader.Peek() != EOF)
+      std::__throw_invalid_argument("Wrong number!");
+    if (width != -1 && count != width)
+      std::__throw_invalid_argument("Rows of different length!");
+    width = count;
+    height++;
+    if (height > INT32_MAX)
+      std::__throw_invalid_argument("Wrong size!");
+  }
+  if (height == 0)
+    std::__throw_invalid_argument("Empty file!");
+  DenseMatrix * m = new DenseMatrix(height, width);
+  m->FillFrom(values.data(), width);
+  m->Transpose();
+  return Preferred(m, nonZeros);
+}
+
+Matrix * MatrixText::Import(const std::string& path)
+{
+  std::unique_ptr<std::FILE, int (*)(std::FILE *)> file(std::fopen(path.c_str(), "rb"), std::fclose);
+  if (!file)
+    std::__throw_invalid_argument("Cannot open the file!");
+  Reader reader(file.get());
+  const std::string marker = "%%MatrixMarket";
+  if (reader.Peek() != '%')
+    return ImportCsv(reader);
+  std::string banner = reader.ReadLine();
+  if (banner.compare(0, marker.size(), marker) != 0)
+    std::__throw_invalid_argument("Not a Matrix Market file!");
+  return ImportMarket(reader, banner);
+}
+
+void MatrixText::ExportMarket(const Matrix& m, Writer& writer)
+{
+  if (typeid(SparseMatrix) != typeid(m))
+  {
+    writer.Write("%%MatrixMarket matrix array real general\n");
+    writer.Write(std::to_string(m.GetHeight()) + " " + std::to_string(m.GetWidth()) + "\n");
+    std::vector<double> column(m.GetHeight());
+    for (int x = 0; x < m.GetWidth(); ++x)
+    {
+      m.CopyColumnTo(x, column.data());
+      for (double val:column)
+      {
+        writer.WriteDouble(val);
+        writer.Write('\n');
+      }
+    }
+    return;
+  }
+  long long count = 0;
+  for (Matrix::NonZeroIterator it(m); it.Next();)
+    count++;
+  writer.Write("%%MatrixMarket matrix coordinate real general\n");
+  writer.Write(std::to_string(m.GetHeight()) + " " + std::to_string(m.GetWidth()) + " " +
+               std::to_string(count) + "\n");
+  for (Matrix::NonZeroIterator it(m); it.Next();)
+  {
+    const Matrix::Entry& entry = it.Get();
+    writer.Write(std::to_string(entry.y + 1));
+    writer.Write(' ');
+    writer.Write(std::to_string(entry.x + 1));
+    writer.Write(' ');
+    writer.WriteDouble(entry.val);
+    writer.Write('\n');
+  }
+}
+
+void MatrixText::ExportCsv(const Matrix& m, Writer& writer)
+{
+  std::vector<double> row(m.GetWidth());
+  for (int y = 0; y < m.GetHeight(); ++y)
+  {
+    m.CopyRowTo(y, row.data());
+    for (int x = 0; x < m.GetWidth(); ++x)
+    {
+      if (x != 0)
+        writer.Write(',');
+      writer.WriteDouble(row[x]);
+    }
+    writer.Write('\n');
+  }
+}
+
+void MatrixText::Export(const Matrix& m, const std::string& path)
+{
+  std::unique_ptr<std::FILE, int (*)(std::FILE *)> file(std::fopen(path.c_str(), "wb"), std::fclose);
+  if (!file)
+    std::__throw_invalid_argument("Cannot open the file!");
+  Writer writer(file.get());
+  const std::string extension = ".mtx";
+  if (path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0)
+    ExportMarket(m, writer);
+  else
+    ExportCsv(m, writer);
+  writer.Flush();
+}
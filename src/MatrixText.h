@@ -0,0 +1,203 @@
+/**
+* @file         MatrixText.h
+* @date         18.10.2026
+* @brief        Definition of the MatrixText
+* @author       miklilad
+*/
+#ifndef SEM_MATRIXTEXT_H
+#define SEM_MATRIXTEXT_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "Matrix.h"
+#include "DenseMatrix.h"
+#include "SparseMatrix.h"
+#include "TripletBuilder.h"
+
+/**
+* @class    MatrixText
+* @brief    Import and export of Matrix Market and CSV text files
+* @details  Files are read and written in large chunks and numbers are parsed and printed without
+* @details  iostreams, always with '.' as the decimal point. Matrix Market is recognized by its banner,
+* @details  any other file is read as CSV: one row per line, values separated by commas.
+* @details  Coordinate Matrix Market goes straight to TripletBuilder and SparseMatrix, array and CSV
+* @details  values are read to a dense buffer, which is kept or turned to SparseMatrix by the number of zeroes.
+* @details  Errors are reported by std::invalid_argument.
+*/
+class MatrixText
+{
+public:
+  /**
+  * @fn        Import
+  * @brief     Reads a matrix from Matrix Market or CSV file at path
+  * @details   Supported Matrix Market files are coordinate or array of real, integer or pattern
+  * @details   field and general, symmetric or skew-symmetric symmetry.
+  * @returns   Pointer to the new matrix
+  */
+  static Matrix * Import(const std::string& path);
+
+  /**
+  * @fn        Export
+  * @brief     Writes m to the file at path, which is overwritten
+  * @details   Files ending with .mtx get Matrix Market: coordinate for SparseMatrix, array otherwise.
+  * @details   Any other file gets CSV. Values are printed with 15 significant digits,
+  * @details   or with 17, if 15 don't read back exactly.
+  */
+  static void Export(const Matrix& m, const std::string& path);
+
+private:
+  /**
+  * Size of the chunks, in which files are read and written
+  */
+  static const size_t CHUNK = 1 << 20;
+
+  /**
+  * Longest token, which is guaranteed to be in the buffer at once
+  */
+  static const size_t LOOKAHEAD = 512;
+
+  /**
+  * @class    Reader
+  * @brief    Buffered tokenizer of a text file
+  */
+  class Reader
+  {
+    std::FILE * file;
+    std::vector<char> buffer;
+    size_t pos;
+    size_t end;
+    bool eof;
+
+    /**
+    * @fn        Fill
+    * @brief     Moves the unread bytes to the front and reads the next chunk, if less than LOOKAHEAD is left
+    */
+    void Fill();
+
+  public:
+    explicit Reader(std::FILE * file);
+
+    /**
+    * @fn        Peek
+    * @returns   Next character or EOF
+    */
+    int Peek();
+
+    /**
+    * @fn        Get
+    * @brief     Skips the next character
+    */
+    void Get();
+
+    /**
+    * @fn        SkipBlanks
+    * @brief     Skips spaces, tabs and '\\r', but not '\\n'
+    */
+    void SkipBlanks();
+
+    /**
+    * @fn        SkipSpaces
+    * @brief     Skips all space-like characters including '\\n'
+    */
+    void SkipSpaces();
+
+    /**
+    * @fn        ReadLine
+    * @returns   Rest of the line without '\\n', which is skipped
+    */
+    std::string ReadLine();
+
+    /**
+    * @fn        ReadDouble
+    * @brief     Parses a number at the current position
+    * @returns   False, if there isn't a number
+    */
+    bool ReadDouble(double& val);
+
+    /**
+    * @fn        ReadInt
+    * @brief     Parses a non-negative integer at the current position
+    * @returns   False, if there isn't one or it's too big
+    */
+    bool ReadInt(long long& val);
+  };
+
+  /**
+  * @class    Writer
+  * @brief    Buffered output to a file
+  */
+  class Writer
+  {
+    std::FILE * file;
+    std::vector<char> buffer;
+    size_t pos;
+
+  public:
+    explicit Writer(std::FILE * file);
+
+    /**
+    * @fn        Write
+    * @brief     Appends text to the buffer, which is written to the file, when it's full
+    */
+    void Write(const char * text, size_t length);
+    void Write(const std::string& text);
+    void Write(char c);
+
+    /**
+    * @fn        WriteDouble
+    * @brief     Appends val as text, which is parsed back to the same value
+    */
+    void WriteDouble(double val);
+
+    /**
+    * @fn        Flush
+    * @brief     Writes the buffer to the file, throws std::invalid_argument on failure
+    */
+    void Flush();
+  };
+
+  /**
+  * @fn        ParseDouble
+  * @brief     Parses a number from text, which ends before end
+  * @details   Up to 19 significant digits are exact, when the value fits the fast path (mantissa below 2^53
+  * @details   and decimal exponent within 22), others are parsed by the standard library in "C" locale.
+  * @param     text - Moved behind the number
+  * @returns   False, if text doesn't start with a number
+  */
+  static bool ParseDouble(const char *& text, const char * end, double& val);
+
+  /**
+  * @fn        ImportMarket
+  * @brief     Reads Matrix Market file, whose banner was already read
+  */
+  static Matrix * ImportMarket(Reader& reader, const std::string& banner);
+
+  /**
+  * @fn        ImportCsv
+  * @brief     Reads CSV file
+  */
+  static Matrix * ImportCsv(Reader& reader);
+
+  /**
+  * @fn        Preferred
+  * @brief     Dense or SparseMatrix, whichever suits the number of zeroes, holding m
+  * @details   m is returned, if it stays dense, and deleted otherwise.
+  */
+  static Matrix * Preferred(DenseMatrix * m, long long nonZeros);
+
+  /**
+  * @fn        ExportMarket
+  * @brief     Writes Matrix Market file
+  */
+  static void ExportMarket(const Matrix& m, Writer& writer);
+
+  /**
+  * @fn        ExportCsv
+  * @brief     Writes CSV file
+  */
+  static void ExportCsv(const Matrix& m, Writer& writer);
+};
+
+
+#endif
@@ -2,20 +2,22 @@
 
 bool Parser::Read()
 {
-  char c = 'a';
   std::string line;
-  while (is.get(c) && c != '\n')
-    line.push_back(c);
-  if (line == "q" || is.eof())
+  // last line of a script may end without '\n', only a read of nothing ends the input
+  if (!std::getline(is, line) && line.empty())
+    return false;
+  if (line == "q")
     return false;
   Parse(line);
+  calc.ResetArena();
   return true;
 }
 
-void Parser::Run()
+bool Parser::Run()
 {
   while (Read())
     continue;
+  return !failed;
 }
 
 void Parser::Parse(const std::string& line)
@@ -23,6 +25,7 @@ void Parser::Parse(const std::string& line)
   std::istringstream iss;
   iss.str(line);
   std::string command, variable, saveTo;
+  std::streampos start = iss.tellg();
   command = ReadAlpha(iss);
   if (CheckAndGetChar(iss, '='))
   {
@@ -32,8 +35,10 @@ void Parser::Parse(const std::string& line)
       WriteError("Wrong variable name!");
       return;
     }
+    start = iss.tellg();
     command = ReadAlpha(iss);
   }
+  variable = command;
   command = ToLower(command);
 
   if (command == "scan")
@@ -54,8 +59,26 @@ void Parser::Parse(const std::string& line)
     ParseDeterminant(iss);
   else if (command == "inverse")
     ParseInverse(iss, saveTo);
-  else if (calc.matricies.find(command) != calc.matricies.end())
-    ParseAddMulSub(iss, command, saveTo);
+  else if (command == "solve")
+    ParseSolve(iss, saveTo);
+  else if (command == "threads" && saveTo.empty())
+    ParseThreads(iss);
+  else if (command == "printlimit" && saveTo.empty())
+    ParsePrintLimit(iss);
+  else if (command == "save" && saveTo.empty())
+    ParseSave(iss);
+  else if (command == "load")
+    ParseLoad(iss, saveTo);
+  else if (command == "export" && saveTo.empty())
+    ParseExport(iss);
+  else if (command == "import")
+    ParseImport(iss, saveTo);
+  else if (command.empty() ? !EndOfLine(iss) : calc.GetVariable(variable) != nullptr)
+  {
+    iss.clear();
+    iss.seekg(start);
+    ParseExpression(iss, saveTo);
+  }
   else if (!command.empty() || !saveTo.empty())
   {
     WriteError("Wrong input!");
@@ -65,18 +88,12 @@ void Parser::Parse(const std::string& line)
 
 void Parser::Scan(const std::string& name, int width, int height)
 {
-  int zeroCount = 0;
-  delete calc.matricies[name];
-  Matrix * dense;
-  try
-  {
-    dense = new DenseMatrix(width, height);
-  }
-  catch (std::exception& e)
+  if (width < 1 || height < 1)
   {
     WriteError("Wrong size!");
     return;
   }
+  TripletBuilder builder(width, height);
   for (int i = 0; i < height; ++i)
   {
     for (int j = 0; j < width; ++j)
@@ -86,36 +103,26 @@ void Parser::Scan(const std::string& name, int width, int height)
       {
         if (is.fail())
         {
+          if (batch)
+            WriteError("Wrong number!");
           is.clear();
           is.ignore(500, '\n');
         }
-        os << "Row " << i + 1 << ", Col " << j + 1 << ": ";
+        if (!batch)
+          os << "Row " << i + 1 << ", Col " << j + 1 << ": ";
         is >> num;
       } while (is.fail() && !is.eof());
-      dense->SetAt(j, i, num);
-      if (num == 0)
-        zeroCount++;
-    }
-  }
-  double referenceRatio = (double) (sizeof(double) + 2 * sizeof(int)) / sizeof(double);
-  double ratio = (double) dense->GetHeight() * dense->GetWidth() / zeroCount;
-  if (ratio < referenceRatio)
-  {
-    Matrix * sparse = new SparseMatrix(width, height);
-    for (int i = 0; i < width; ++i)
-    {
-      for (int j = 0; j < height; ++j)
+      // input ended before all the values were read, the matrix isn't saved
+      if (is.fail())
       {
-        double val = dense->At(i, j);
-        if (val != 0)
-          sparse->SetAt(i, j, val);
+        WriteError("Wrong number!");
+        return;
       }
+      if (num != 0)
+        builder.Add(j, i, num);
     }
-    calc.matricies[name] = sparse;
-    delete dense;
   }
-  else
-    calc.matricies[name] = dense;
+  calc.SetVariable(name, builder.BuildPreferred());
 }
 
 char Parser::ReadArgument(std::istringstream& iss) const
@@ -158,6 +165,19 @@ std::string Parser::ReadAlpha(std::istringstream& iss) const
   return var;
 }
 
+std::string Parser::ReadPath(std::istringstream& iss) const
+{
+  std::string path;
+  char c;
+  GetRidOfSpaces(iss);
+  while (iss.peek() != EOF && !std::isspace(iss.peek()))
+  {
+    iss.get(c);
+    path.push_back(c);
+  }
+  return path;
+}
+
 int Parser::ReadNum(std::istringstream& iss) const
 {
   std::string var;
@@ -194,7 +214,8 @@ bool Parser::EndOfCommand(std::istringstream& iss) const
   return iss.fail();
 }
 
-Parser::Parser(std::istream& is, std::ostream& os) : is(is), os(os), calc(os)
+Parser::Parser(std::istream& is, std::ostream& os, bool batch) : is(is), os(os), batch(batch), failed(false),
+                                                                calc(os, !batch)
 {
 
 }
@@ -264,13 +285,12 @@ void Parser::ParseGem(std::istringstream& iss, const std::string& saveTo)
     WriteError(msg);
     return;
   }
-  Matrix * gemed = calc.GEM(*calc.matricies[variable], commentary);
+  Matrix * gemed = calc.GEM(*calc.GetVariable(variable), commentary);
   if (saveTo.empty() && !commentary)
     calc.PrintMatrix(gemed);
   if (!saveTo.empty())
   {
-    delete calc.matricies[saveTo];
-    calc.matricies[saveTo] = gemed;
+    calc.SetVariable(saveTo, gemed);
   }
   else
     delete gemed;
@@ -291,12 +311,12 @@ void Parser::ParseTranspose(std::istringstream& iss)
     WriteError("Command not properly ended!");
     return;
   }
-  calc.matricies[variable]->Transpose();
+  calc.TransposeVariable(variable);
 }
 
 bool Parser::CheckVariableUsage(const std::string& variable) const
 {
-  if (calc.matricies.find(variable) == calc.matricies.end())
+  if (!calc.GetVariable(variable))
   {
     WriteError("Variable not used!");
     return false;
@@ -306,18 +326,34 @@ bool Parser::CheckVariableUsage(const std::string& variable) const
 
 void Parser::WriteError(const char * msg) const
 {
-  os << "\033[1;91m" << msg << "\033[0m" << std::endl;
+  failed = true;
+  if (batch)
+    os << msg << '\n';
+  else
+    os << "\033[1;91m" << msg << "\033[0m\n";
 }
 
 void Parser::ParsePrint(std::istringstream& iss) const
 {
+  MatrixPrinter::Mode mode = MatrixPrinter::AUTO;
+  char c = ReadArgument(iss);
+  if (c == 'a')
+    mode = MatrixPrinter::WHOLE;
+  else if (c == 'n')
+    mode = MatrixPrinter::NONZEROS;
+  else if (c != 0)
+  {
+    WriteError(c == 1 ? "Syntax Error" : "Unknown argument!");
+    return;
+  }
   std::string variable = ReadAlpha(iss);
   if (!EndOfCommand(iss))
   {
     WriteError("Command not properly ended!");
     return;
   }
-  calc.PrintVariable(variable);
+  if (!calc.PrintVariable(variable, mode))
+    failed = true;
 }
 
 void Parser::ParseRank(std::istringstream& iss) const
@@ -330,8 +366,7 @@ void Parser::ParseRank(std::istringstream& iss) const
     WriteError("Command not properly ended!");
     return;
   }
-  const auto& m = calc.matricies.find(variable);
-  os << calc.Rank(*m->second) << std::endl;
+  os << calc.Rank(variable) << '\n';
 }
 
 void Parser::ParseSplit(std::istringstream& iss, const std::string& saveTo)
@@ -364,8 +399,8 @@ void Parser::ParseSplit(std::istringstream& iss, const std::string& saveTo)
       throw "Wrong size!";
     if (width == -1 || height == -1 || x == -1 || y == -1)
       throw "Syntax error!";
-    if (calc.matricies[variable]->GetHeight() < y + height ||
-        calc.matricies[variable]->GetWidth() < x + width)
+    if (calc.GetVariable(variable)->GetHeight() < y + height ||
+        calc.GetVariable(variable)->GetWidth() < x + width)
       throw "Area out of matrix bounds!";
   }
   catch (const char * msg)
@@ -373,7 +408,7 @@ void Parser::ParseSplit(std::istringstream& iss, const std::string& saveTo)
     WriteError(msg);
     return;
   }
-  Matrix * splitted = calc.Split(*calc.matricies[variable], x, y, width, height);
+  Matrix * splitted = calc.Split(*calc.GetVariable(variable), x, y, width, height);
   if (saveTo.empty())
   {
     calc.PrintMatrix(splitted);
@@ -381,8 +416,7 @@ void Parser::ParseSplit(std::istringstream& iss, const std::string& saveTo)
   }
   else
   {
-    delete calc.matricies[saveTo];
-    calc.matricies[saveTo] = splitted;
+    calc.SetVariable(saveTo, splitted);
   }
 }
 
@@ -402,9 +436,9 @@ void Parser::ParseMerge(std::istringstream& iss, const std::string& saveTo)
       throw "Syntax Error";
     else if (c != 0)
       throw "Unknown argument!";
-    if (calc.matricies.find(variable) == calc.matricies.end())
+    if (!calc.GetVariable(variable))
       throw "First matrix not declared";
-    if (calc.matricies.find(variable2) == calc.matricies.end())
+    if (!calc.GetVariable(variable2))
       throw "Second matrix not declared";
     if (!EndOfCommand(iss))
       throw "Command not properly ended!";
@@ -414,9 +448,12 @@ void Parser::ParseMerge(std::istringstream& iss, const std::string& saveTo)
     WriteError(msg);
     return;
   }
-  Matrix * m = calc.Merge(*calc.matricies[variable], *calc.matricies[variable2], mergeDirection);
+  Matrix * m = calc.Merge(*calc.GetVariable(variable), *calc.GetVariable(variable2), mergeDirection);
   if (m == nullptr)
+  {
+    failed = true;
     return;
+  }
   if (saveTo.empty())
   {
     calc.PrintMatrix(m);
@@ -424,8 +461,7 @@ void Parser::ParseMerge(std::istringstream& iss, const std::string& saveTo)
   }
   else
   {
-    delete calc.matricies[saveTo];
-    calc.matricies[saveTo] = m;
+    calc.SetVariable(saveTo, m);
   }
 }
 
@@ -439,50 +475,43 @@ void Parser::ParseDeterminant(std::istringstream& iss) const
     WriteError("Command not ended properly!");
     return;
   }
-  const auto& m = calc.matricies.find(variable);
-  if (m->second->GetWidth() == m->second->GetHeight())
-    os << calc.Determinant(*m->second) << std::endl;
+  const Matrix * m = calc.GetVariable(variable);
+  if (m->GetWidth() == m->GetHeight())
+    os << calc.Determinant(variable) << '\n';
   else
     WriteError("Not a square matrix!");
 }
 
-void Parser::ParseAddMulSub(std::istringstream& iss, const std::string& variable, const std::string& saveTo)
+void Parser::ParseExpression(std::istringstream& iss, const std::string& saveTo)
 {
-  char c = 0;
-  if (CheckAndGetChar(iss, '+'))
-    c = '+';
-  else if (CheckAndGetChar(iss, '*'))
-    c = '*';
-  else if (CheckAndGetChar(iss, '-'))
-    c = '-';
-  else
+  std::unique_ptr<Expression> expression;
+  try
   {
-    WriteError("Unknown operator!");
-    return;
+    expression = ParseSum(iss);
+    if (!EndOfCommand(iss))
+      throw "Unknown operator!";
   }
-  std::string variable2 = ReadAlpha(iss);
-  if (!CheckVariableUsage(variable2))
+  catch (const char * msg)
+  {
+    WriteError(msg);
     return;
-  if (!EndOfCommand(iss))
+  }
+  if (expression->IsScalar())
   {
-    WriteError("Command not properly ended!");
+    if (saveTo.empty())
+      os << calc.EvaluateScalar(*expression) << '\n';
+    else
+      WriteError("Not a matrix!");
     return;
   }
   Matrix * result;
-  if (c == '+')
-    result = calc.Add(*calc.matricies[variable], *calc.matricies[variable2]);
-  else if (c == '*')
-    result = calc.Multiply(*calc.matricies[variable], *calc.matricies[variable2]);
-  else
+  try
   {
-    Matrix * m = calc.matricies[variable2]->GetCopy();
-    m->ScalarMul(-1);
-    result = calc.Add(*m, *calc.matricies[variable]);
-    delete m;
+    result = calc.Evaluate(*expression);
   }
-  if (!result)
+  catch (const std::invalid_argument& e)
   {
-    WriteError("Dimensions don't match!");
+    WriteError(e.what());
     return;
   }
   if (saveTo.empty())
@@ -492,11 +521,64 @@ void Parser::ParseAddMulSub(std::istringstream& iss, const std::string& variable
   }
   else
   {
-    delete calc.matricies[saveTo];
-    calc.matricies[saveTo] = result;
+    calc.SetVariable(saveTo, result);
   }
 }
 
+std::unique_ptr<Expression> Parser::ParseSum(std::istringstream& iss) const
+{
+  std::unique_ptr<Expression> left = ParseProduct(iss);
+  while (true)
+  {
+    if (CheckAndGetChar(iss, '+'))
+      left.reset(new Expression(Expression::ADD, std::move(left), ParseProduct(iss)));
+    else if (CheckAndGetChar(iss, '-'))
+      left.reset(new Expression(Expression::SUBTRACT, std::move(left), ParseProduct(iss)));
+    else
+      return left;
+  }
+}
+
+std::unique_ptr<Expression> Parser::ParseProduct(std::istringstream& iss) const
+{
+  std::unique_ptr<Expression> left = ParseFactor(iss);
+  while (CheckAndGetChar(iss, '*'))
+    left.reset(new Expression(Expression::MULTIPLY, std::move(left), ParseFactor(iss)));
+  return left;
+}
+
+std::unique_ptr<Expression> Parser::ParseFactor(std::istringstream& iss) const
+{
+  if (CheckAndGetChar(iss, '-'))
+    return std::unique_ptr<Expression>(new Expression(Expression::NEGATE, ParseFactor(iss)));
+  if (CheckAndGetChar(iss, '('))
+  {
+    std::unique_ptr<Expression> inner = ParseSum(iss);
+    if (!CheckAndGetChar(iss, ')'))
+      throw "Missing parenthesis!";
+    return inner;
+  }
+  if (std::isdigit(iss.peek()) || iss.peek() == '.')
+  {
+    double number;
+    if (!(iss >> number))
+      throw "Wrong number!";
+    return std::unique_ptr<Expression>(new Expression(number));
+  }
+  std::string variable = ReadAlpha(iss);
+  if (variable.empty())
+    throw "Wrong Syntax!";
+  if (!calc.GetVariable(variable))
+    throw "Variable not used!";
+  return std::unique_ptr<Expression>(new Expression(variable));
+}
+
+bool Parser::EndOfLine(std::istringstream& iss) const
+{
+  GetRidOfSpaces(iss);
+  return iss.peek() == EOF;
+}
+
 void Parser::ParseInverse(std::istringstream& iss, const std::string& saveTo)
 {
   std::string variable = ReadAlpha(iss);
@@ -510,7 +592,7 @@ void Parser::ParseInverse(std::istringstream& iss, const std::string& saveTo)
   Matrix * m = nullptr;
   try
   {
-    m = calc.Inverse(*calc.matricies[variable]);
+    m = calc.Inverse(variable);
   }
   catch (const std::invalid_argument& e)
   {
@@ -524,7 +606,284 @@ void Parser::ParseInverse(std::istringstream& iss, const std::string& saveTo)
   }
   else
   {
-    delete calc.matricies[saveTo];
-    calc.matricies[saveTo] = m;
+    calc.SetVariable(saveTo, m);
+  }
+}
+
+void Parser::ParseThreads(std::istringstream& iss)
+{
+  int count = -1;
+  try
+  {
+    count = ReadNum(iss);
+    if (!EndOfCommand(iss))
+      throw "Command not properly ended!";
+  }
+  catch (const char * msg)
+  {
+    WriteError(msg);
+    return;
+  }
+  catch (std::out_of_range& e)
+  {
+    WriteError("Number out of range!");
+    return;
+  }
+  if (count == -1)
+    os << calc.GetThreads() << '\n';
+  else
+    calc.SetThreads(count);
+}
+
+void Parser::ParsePrintLimit(std::istringstream& iss)
+{
+  int limit = -1, edge = -1;
+  try
+  {
+    limit = ReadNum(iss);
+    if (limit != -1)
+      edge = ReadNum(iss);
+    if (!EndOfCommand(iss))
+      throw "Command not properly ended!";
+    if (edge == -1)
+      edge = calc.GetPrintEdge();
+    if (limit != -1 && limit != 0 && (edge < 1 || 2 * edge > limit))
+      throw "Wrong limit!";
+  }
+  catch (const char * msg)
+  {
+    WriteError(msg);
+    return;
+  }
+  catch (std::out_of_range& e)
+  {
+    WriteError("Number out of range!");
+    return;
+  }
+  if (limit == -1)
+    os << calc.GetPrintLimit() << ' ' << calc.GetPrintEdge() << '\n';
+  else
+    calc.SetPrintLimit(limit, edge);
+}
+
+void Parser::ParseSolve(std::istringstream& iss, const std::string& saveTo)
+{
+  bool iterative = false;
+  IterativeSolver::Settings settings;
+  std::string variable, variable2;
+  try
+  {
+    char c = ReadArgument(iss);
+    if (c == 'i')
+      iterative = true;
+    else if (c == 1)
+      throw "Syntax Error";
+    else if (c != 0)
+      throw "Unknown argument!";
+    variable = ReadAlpha(iss);
+    variable2 = ReadAlpha(iss);
+    if (!CheckVariableUsage(variable) || !CheckVariableUsage(variable2))
+      return;
+    if (iterative)
+      ParseSolverSettings(iss, settings);
+    if (!EndOfCommand(iss))
+      throw "Command not ended properly!";
+  }
+  catch (const char * msg)
+  {
+    WriteError(msg);
+    return;
+  }
+  Matrix * m = nullptr;
+  try
+  {
+    if (iterative)
+    {
+      IterativeSolver::Result result;
+      m = calc.SolveIterative(variable, variable2, settings, result);
+      os << "Iterations: " << result.iterations << ", residual: " << result.residual << '\n';
+      if (!result.converged)
+        WriteError("Solver didn't converge!");
+    }
+    else
+      m = calc.Solve(variable, variable2);
+  }
+  catch (const std::invalid_argument& e)
+  {
+    WriteError(e.what());
+    return;
+  }
+  if (saveTo.empty())
+  {
+    calc.PrintMatrix(m);
+    delete m;
+  }
+  else
+  {
+    calc.SetVariable(saveTo, m);
+  }
+}
+
+void Parser::ParseSolverSettings(std::istringstream& iss, IterativeSolver::Settings& settings) const
+{
+  std::string option;
+  while (!(option = ToLower(ReadAlpha(iss))).empty())
+  {
+    if (option == "cg")
+      settings.method = IterativeSolver::CG;
+    else if (option == "bicgstab")
+      settings.method = IterativeSolver::BICGSTAB;
+    else if (option == "gmres")
+      settings.method = IterativeSolver::GMRES;
+    else if (option == "none")
+      settings.preconditioner = IterativeSolver::NONE;
+    else if (option == "jacobi")
+      settings.preconditioner = IterativeSolver::JACOBI;
+    else if (option == "ilu")
+      settings.preconditioner = IterativeSolver::ILU0;
+    else if (option == "tol")
+    {
+      GetRidOfSpaces(iss);
+      if (!(iss >> settings.tolerance) || settings.tolerance <= 0)
+        throw "Wrong tolerance!";
+    }
+    else if (option == "iter")
+    {
+      settings.maxIterations = ReadNum(iss);
+      if (settings.maxIterations < 1)
+        throw "Wrong number of iterations!";
+    }
+    else if (option == "restart")
+    {
+      settings.restart = ReadNum(iss);
+      if (settings.restart < 1)
+        throw "Wrong restart!";
+    }
+    else
+      throw "Unknown option!";
+  }
+}
+
+void Parser::ParseSave(std::istringstream& iss) const
+{
+  std::string variable = ReadAlpha(iss);
+  std::string path;
+  try
+  {
+    if (variable.empty())
+      throw "Wrong variable name!";
+    if (!CheckVariableUsage(variable))
+      return;
+    path = ReadPath(iss);
+    if (path.empty())
+      throw "Missing file name!";
+    if (!EndOfCommand(iss))
+      throw "Command not properly ended!";
+    calc.Save(variable, path);
+  }
+  catch (const char * msg)
+  {
+    WriteError(msg);
+  }
+  catch (const std::invalid_argument& e)
+  {
+    WriteError(e.what());
+  }
+}
+
+void Parser::ParseLoad(std::istringstream& iss, std::string& saveTo)
+{
+  bool verify = false;
+  Matrix * m = nullptr;
+  try
+  {
+    char c = ReadArgument(iss);
+    if (c == 'c')
+      verify = true;
+    else if (c == 1)
+      throw "Syntax Error";
+    else if (c != 0)
+      throw "Unknown argument!";
+    if (saveTo.empty())
+    {
+      saveTo = ReadAlpha(iss);
+      if (saveTo.empty())
+        throw "Wrong variable name!";
+    }
+    std::string path = ReadPath(iss);
+    if (path.empty())
+      throw "Missing file name!";
+    if (!EndOfCommand(iss))
+      throw "Command not properly ended!";
+    m = calc.Load(path, verify);
+  }
+  catch (const char * msg)
+  {
+    WriteError(msg);
+    return;
+  }
+  catch (const std::invalid_argument& e)
+  {
+    WriteError(e.what());
+    return;
+  }
+  calc.SetVariable(saveTo, m);
+}
+
+void Parser::ParseExport(std::istringstream& iss) const
+{
+  std::string variable = ReadAlpha(iss);
+  std::string path;
+  try
+  {
+    if (variable.empty())
+      throw "Wrong variable name!";
+    if (!CheckVariableUsage(variable))
+      return;
+    path = ReadPath(iss);
+    if (path.empty())
+      throw "Missing file name!";
+    if (!EndOfCommand(iss))
+      throw "Command not properly ended!";
+    calc.Export(variable, path);
+  }
+  catch (const char * msg)
+  {
+    WriteError(msg);
+  }
+  catch (const std::invalid_argument& e)
+  {
+    WriteError(e.what());
+  }
+}
+
+void Parser::ParseImport(std::istringstream& iss, std::string& saveTo)
+{
+  Matrix * m = nullptr;
+  try
+  {
+    if (saveTo.empty())
+    {
+      saveTo = ReadAlpha(iss);
+      if (saveTo.empty())
+        throw "Wrong variable name!";
+    }
+    std::string path = ReadPath(iss);
+    if (path.empty())
+      throw "Missing file name!";
+    if (!EndOfCommand(iss))
+      throw "Command not properly ended!";
+    m = calc.Import(path);
+  }
+  catch (const char * msg)
+  {
+    WriteError(msg);
+    return;
+  }
+  catch (const std::invalid_argument& e)
+  {
+    WriteError(e.what());
+    return;
   }
+  calc.SetVariable(saveTo, m);
 }
@@ -8,6 +8,7 @@
 #define SEM_PARSER_H
 
 #include "Calculator.h"
+#include "Expression.h"
 
 /**
 * @class    Parser
@@ -19,11 +20,13 @@ class Parser
 {
   std::istream& is;
   std::ostream& os;
+  bool batch;
+  mutable bool failed;
   Calculator calc;
 
   /**
   * @fn        Read
-  * @brief     Reads input from input stream until '\\n' is reached and saves it to string.
+  * @brief     Reads a line from input stream and passes it to Parse
   * @returns   False , if extracted  string is "q" or eof was reached. Returns True otherwise
   */
   bool Read();
@@ -72,6 +75,7 @@ class Parser
   * @brief     Reads the rest of iss, parses and executes command
   * @param     iss - Stream from which the commands are parsed
   * @details   Reads from iss and prints variable, if the syntax was respected.
+  * @details   Argument -a prints every element of a large matrix, -n lists its nonzero elements.
   */
   void ParsePrint(std::istringstream& iss) const;
 
@@ -114,14 +118,111 @@ class Parser
   void ParseInverse(std::istringstream& iss, const std::string& saveTo);
 
   /**
-  * @fn        ParseAddMulSub
+  * @fn        ParseSolve
   * @brief     Reads the rest of iss, parses and executes command
   * @param     iss - Stream from which the commands are parsed
   * @param     saveTo - Variable name, into which the result is to be saved
-  * @param     variable - First operand already read in Parse()
-  * @details   Reads from iss an operator and an operand and executes given command over the two operands.
+  * @details   Solves A * X = B for variables A and B, if the syntax was respected,
+  * @details   and prints X to os or saves it to calc, if saveTo isn't empty.
+  * @details   With argument -i an iterative method is used and its iterations and residual are printed.
   */
-  void ParseAddMulSub(std::istringstream& iss, const std::string& variable, const std::string& saveTo);
+  void ParseSolve(std::istringstream& iss, const std::string& saveTo);
+
+  /**
+  * @fn        ParseSolverSettings
+  * @brief     Reads options of an iterative solver until the end of iss
+  * @param     settings - Defaults, which are overwritten by the options
+  * @details   Options are method (cg, bicgstab, gmres), preconditioner (none, jacobi, ilu),
+  * @details   "tol" number, "iter" number and "restart" number. Throws const char * on a wrong option.
+  */
+  void ParseSolverSettings(std::istringstream& iss, IterativeSolver::Settings& settings) const;
+
+  /**
+  * @fn        ParseThreads
+  * @brief     Reads the rest of iss, parses and executes command
+  * @param     iss - Stream from which the commands are parsed
+  * @details   Sets the number of threads used by calc, if a number is given (0 for number of cores).
+  * @details   Prints the number of threads otherwise.
+  */
+  void ParseThreads(std::istringstream& iss);
+
+  /**
+  * @fn        ParsePrintLimit
+  * @brief     Reads the rest of iss, parses and executes command
+  * @param     iss - Stream from which the commands are parsed
+  * @details   Sets the largest number of rows or columns printed whole (0 for no limit) and optionally
+  * @details   the number of rows or columns shown from each side of larger matricies, if numbers are given.
+  * @details   Prints both numbers otherwise.
+  */
+  void ParsePrintLimit(std::istringstream& iss);
+
+  /**
+  * @fn        ParseSave
+  * @brief     Reads the rest of iss, parses and executes command
+  * @param     iss - Stream from which the commands are parsed
+  * @details   Writes variable to the file, whose path follows it, if the syntax was respected.
+  */
+  void ParseSave(std::istringstream& iss) const;
+
+  /**
+  * @fn        ParseLoad
+  * @brief     Reads the rest of iss, parses and executes command
+  * @param     iss - Stream from which the commands are parsed
+  * @param     saveTo - Variable name, into which the result is to be saved
+  * @details   Reads the matrix from the file and saves it to saveTo or to the variable named
+  * @details   before the path, if saveTo is empty. With argument -c the checksum of the whole file is checked.
+  */
+  void ParseLoad(std::istringstream& iss, std::string& saveTo);
+
+  /**
+  * @fn        ParseExport
+  * @brief     Reads the rest of iss, parses and executes command
+  * @param     iss - Stream from which the commands are parsed
+  * @details   Writes variable to Matrix Market (path ending with .mtx) or CSV file, if the syntax was respected.
+  */
+  void ParseExport(std::istringstream& iss) const;
+
+  /**
+  * @fn        ParseImport
+  * @brief     Reads the rest of iss, parses and executes command
+  * @param     iss - Stream from which the commands are parsed
+  * @param     saveTo - Variable name, into which the result is to be saved
+  * @details   Reads the matrix from Matrix Market or CSV file and saves it to saveTo
+  * @details   or to the variable named before the path, if saveTo is empty.
+  */
+  void ParseImport(std::istringstream& iss, std::string& saveTo);
+
+  /**
+  * @fn        ParseExpression
+  * @brief     Reads the rest of iss, parses and evaluates an expression
+  * @param     iss - Stream from which the expression is parsed
+  * @param     saveTo - Variable name, into which the result is to be saved
+  * @details   Expression is made of variables, numbers, parentheses, unary minus and operators +, -, *
+  * @details   with the usual precedence. The value is printed to os or saved to calc, if saveTo isn't empty.
+  */
+  void ParseExpression(std::istringstream& iss, const std::string& saveTo);
+
+  /**
+  * @fn        ParseSum
+  * @brief     Parses products separated by + and -
+  * @details   Throws const char * on a syntax error or an unknown variable.
+  * @returns   Syntax tree of the sum
+  */
+  std::unique_ptr<Expression> ParseSum(std::istringstream& iss) const;
+
+  /**
+  * @fn        ParseProduct
+  * @brief     Parses factors separated by *
+  * @returns   Syntax tree of the product
+  */
+  std::unique_ptr<Expression> ParseProduct(std::istringstream& iss) const;
+
+  /**
+  * @fn        ParseFactor
+  * @brief     Parses a variable, a number, an expression in parentheses or a factor with unary minus
+  * @returns   Syntax tree of the factor
+  */
+  std::unique_ptr<Expression> ParseFactor(std::istringstream& iss) const;
 
   /**
   * @fn        Scan
@@ -129,7 +230,8 @@ class Parser
   * @param     name - Name of the matrix variable to be created
   * @param     width - Number of collums in the matrix
   * @param     height - Number of rows in the matrix
-  * @details   Depending on number of zeroes, it saves the values in Dense/SparseMatrix
+  * @details   Depending on number of zeroes, it saves the values in Dense/SparseMatrix.
+  * @details   Every value is prompted for, unless in batch mode, where a wrong value is an error.
   */
   void Scan(const std::string& name, int width, int height);
 
@@ -167,6 +269,13 @@ class Parser
   */
   std::string ReadAlpha(std::istringstream& iss) const;
 
+  /**
+  * @fn        ReadPath
+  * @brief     Reads from iss until any space-like character is reached
+  * @returns   Path to a file or an empty string
+  */
+  std::string ReadPath(std::istringstream& iss) const;
+
   /**
   * @fn        ReadNum
   * @brief     Reads positive integer from iss
@@ -195,6 +304,12 @@ class Parser
   */
   bool EndOfCommand(std::istringstream& iss) const;
 
+  /**
+  * @fn        EndOfLine
+  * @returns   True, if there are only spaces left in iss, which are skipped
+  */
+  bool EndOfLine(std::istringstream& iss) const;
+
   /**
   * @fn        CheckVariableUsage
   * @brief     Checks if a matrix of given name is in calc
@@ -206,18 +321,23 @@ class Parser
   * @fn        WriteError
   * @brief     Writes out an error message
   * @param     msg - Error to be written
-  * @details   Highlights the msg in bold red, passes it to os with endl at the end
+  * @details   Highlights the msg in bold red, unless in batch mode, passes it to os with '\\n' at the end
+  * @details   and marks, that a command failed.
   */
   void WriteError(const char * msg) const;
 
 public:
-  Parser(std::istream& is = std::cin, std::ostream& os = std::cout);
+  /**
+  * @param     batch - Non-interactive mode for scripts: no prompts and no ANSI escape codes in the output
+  */
+  Parser(std::istream& is = std::cin, std::ostream& os = std::cout, bool batch = false);
 
   /**
-  * @fn        WriteError
+  * @fn        Run
   * @brief     Reads input from is while it can
+  * @returns   False, if any command failed
   */
-  void Run();
+  bool Run();
 };
 
 
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include "SparseKernels.h"
+
+std::vector<int> SparseKernels::SplitRows(const std::vector<long long>& work, int parts)
+{
+  int height = work.size() - 1;
+  std::vector<int> bounds(parts + 1, height);
+  bounds[0] = 0;
+  for (int p = 1; p < parts; ++p)
+  {
+    long long target = work[height] / parts * p;
+    bounds[p] = std::lower_bound(work.begin(), work.end(), target) - work.begin();
+    bounds[p] = std::max(bounds[p - 1], std::min(bounds[p], height));
+  }
+  return bounds;
+}
+
+SparseMatrix * SparseKernels::Multiply(const SparseMatrix& m1, const SparseMatrix& m2, ThreadPool * pool)
+{
+  int width = m2.GetWidth();
+  int height = m1.GetHeight();
+  const int * aPtr = m1.GetRowPointers();
+  const int * aIdx = m1.GetColumnIndices();
+  const double * aVal = m1.GetValues();
+  const int * bPtr = m2.GetRowPointers();
+  const int * bIdx = m2.GetColumnIndices();
+  const double * bVal = m2.GetValues();
+
+  std::vector<long long> work(height + 1, 0);
+  for (int y = 0; y < height; ++y)
+  {
+    long long flops = 0;
+    for (int i = aPtr[y]; i < aPtr[y + 1]; ++i)
+      flops += bPtr[aIdx[i] + 1] - bPtr[aIdx[i]];
+    work[y + 1] = work[y] + flops;
+  }
+  int parts = 1;
+  if (pool && work[height] >= PARALLELTHRESHOLD)
+    parts = pool->GetThreadCount();
+  std::vector<int> bounds = SplitRows(work, parts);
+  auto run = [&](const std::function<void(int)>& task)
+  {
+    if (pool)
+      pool->Run(parts, task);
+    else
+      task(0);
+  };
+
+  // Symbolic pass: number of nonzeros in every row of the result
+  std::vector<int> rowPtr(height + 1, 0);
+  run([&](int part)
+  {
+    std::vector<int> marker(width, -1);
+    for (int y = bounds[part]; y < bounds[part + 1]; ++y)
+    {
+      int count = 0;
+      for (int i = aPtr[y]; i < aPtr[y + 1]; ++i)
+        for (int j = bPtr[aIdx[i]]; j < bPtr[aIdx[i] + 1]; ++j)
+          if (marker[bIdx[j]] != y)
+          {
+            marker[bIdx[j]] = y;
+            count++;
+          }
+      rowPtr[y + 1] = count;
+    }
+  });
+  for (int y = 0; y < height; ++y)
+    rowPtr[y + 1] += rowPtr[y];
+
+  // Numeric pass: every row is accumulated and written to its place
+  std::vector<int> colIdx(rowPtr[height]);
+  std::vector<double> values(rowPtr[height]);
+  run([&](int part)
+  {
+    std::vector<int> marker(width, -1);
+    std::vector<double> acc(width);
+    for (int y = bounds[part]; y < bounds[part + 1]; ++y)
+    {
+      int pos = rowPtr[y];
+      for (int i = aPtr[y]; i < aPtr[y + 1]; ++i)
+      {
+        double factor = aVal[i];
+        for (int j = bPtr[aIdx[i]]; j < bPtr[aIdx[i] + 1]; ++j)
+        {
+          int x = bIdx[j];
+          if (marker[x] != y)
+          {
+            marker[x] = y;
+            colIdx[pos++] = x;
+            acc[x] = factor * bVal[j];
+          }
+          else
+            acc[x] += factor * bVal[j];
+        }
+      }
+      std::sort(colIdx.begin() + rowPtr[y], colIdx.begin() + pos);
+      for (int i = rowPtr[y]; i < pos; ++i)
+        values[i] = acc[colIdx[i]];
+    }
+  });
+
+  // Products, which cancelled out, are not kept
+  int stored = 0;
+  for (int y = 0; y < height; ++y)
+  {
+    int begin = rowPtr[y];
+    rowPtr[y] = stored;
+    for (int i = begin; i < rowPtr[y + 1]; ++i)
+      if (values[i] != 0)
+      {
+        colIdx[stored] = colIdx[i];
+        values[stored++] = values[i];
+      }
+  }
+  rowPtr[height] = stored;
+  colIdx.resize(stored);
+  values.resize(stored);
+  return new SparseMatrix(width, height, std::move(rowPtr), std::move(colIdx), std::move(values));
+}
+
+void SparseKernels::MultiplyDense(const SparseMatrix& s, const double * b, int ldb, int n, double * c, int ldc,
+                                  ThreadPool * pool)
+{
+  int height = s.GetHeight();
+  const int * rowPtr = s.GetRowPointers();
+  const int * colIdx = s.GetColumnIndices();
+  const double * values = s.GetValues();
+  std::vector<long long> work(height + 1);
+  for (int y = 0; y <= height; ++y)
+    work[y] = rowPtr[y];
+  int parts = 1;
+  if (pool && (long long) rowPtr[height] * n >= PARALLELTHRESHOLD)
+    parts = pool->GetThreadCount();
+  std::vector<int> bounds = SplitRows(work, parts);
+  auto task = [&](int part)
+  {
+    for (int x = 0; x < n; ++x)
+    {
+      const double * column = b + (size_t) x * ldb;
+      double * result = c + (size_t) x * ldc;
+      for (int y = bounds[part]; y < bounds[part + 1]; ++y)
+      {
+        double sum = 0;
+        for (int i = rowPtr[y]; i < rowPtr[y + 1]; ++i)
+          sum += values[i] * column[colIdx[i]];
+        result[y] = sum;
+      }
+    }
+  };
+  if (pool)
+    pool->Run(parts, task);
+  else
+    task(0);
+}
+
+void SparseKernels::DenseMultiply(const double * a, int lda, int m, const SparseMatrix& s, double * c, int ldc,
+                                  ThreadPool * pool)
+{
+  int width = s.GetWidth();
+  const int * colPtr = s.GetColumnPointers();
+  const int * rowIdx = s.GetRowIndices();
+  const int * colPos = s.GetColumnPositions();
+  const double * values = s.GetValues();
+  std::vector<long long> work(width + 1);
+  for (int x = 0; x <= width; ++x)
+    work[x] = colPtr[x];
+  int parts = 1;
+  if (pool && (long long) colPtr[width] * m >= PARALLELTHRESHOLD)
+    parts = pool->GetThreadCount();
+  std::vector<int> bounds = SplitRows(work, parts);
+  auto task = [&](int part)
+  {
+    for (int x = bounds[part]; x < bounds[part + 1]; ++x)
+    {
+      double * result = c + (size_t) x * ldc;
+      for (int i = colPtr[x]; i < colPtr[x + 1]; ++i)
+      {
+        const double * column = a + (size_t) rowIdx[i] * lda;
+        double factor = values[colPos[i]];
+        for (int y = 0; y < m; ++y)
+          result[y] += factor * column[y];
+      }
+    }
+  };
+  if (pool)
+    pool->Run(parts, task);
+  else
+    task(0);
+}
@@ -0,0 +1,69 @@
+/**
+* @file         SparseKernels.h
+* @date         18.10.2026
+* @brief        Definition of the SparseKernels
+* @author       miklilad
+*/
+#ifndef SEM_SPARSEKERNELS_H
+#define SEM_SPARSEKERNELS_H
+
+#include <vector>
+#include "SparseMatrix.h"
+#include "ThreadPool.h"
+
+/**
+* @class    SparseKernels
+* @brief    Operations working directly on CSR storage of SparseMatrix
+* @details  Cost of every kernel depends on the number of stored elements, not on the dimensions.
+*/
+class SparseKernels
+{
+  /**
+  * Smallest number of multiply-adds worth splitting between threads
+  */
+  static const long PARALLELTHRESHOLD = 1L << 16;
+
+  /**
+  * @fn        SplitRows
+  * @brief     Splits rows (or columns) into parts with about the same amount of work
+  * @param     work - Work of rows 0 .. y - 1 for every y in 0 .. height
+  * @returns   First row of every part followed by height
+  */
+  static std::vector<int> SplitRows(const std::vector<long long>& work, int parts);
+
+public:
+  /**
+  * @fn        Multiply
+  * @brief     Multiplies 2 sparse matricies (Gustavson's row-by-row algorithm)
+  * @details   Symbolic pass counts the nonzeros of every row of the result, so that
+  * @details   the numeric pass writes directly into preallocated CSR arrays. Rows are
+  * @details   accumulated in a dense array with a list of touched columns.
+  * @returns   Pointer to the new matrix
+  */
+  static SparseMatrix * Multiply(const SparseMatrix& m1, const SparseMatrix& m2, ThreadPool * pool = nullptr);
+
+  /**
+  * @fn        MultiplyDense
+  * @brief     C = S * B, where B is dense with n columns
+  * @param     b, ldb - Column-major buffer of B and distance between its columns
+  * @param     c, ldc - Column-major buffer of C, which is overwritten
+  * @details   Every column of B is read contiguously and gathered by the rows of S.
+  * @details   Threads split the rows of S by their number of nonzeros.
+  */
+  static void MultiplyDense(const SparseMatrix& s, const double * b, int ldb, int n, double * c, int ldc,
+                            ThreadPool * pool = nullptr);
+
+  /**
+  * @fn        DenseMultiply
+  * @brief     C = A * S, where A is dense with m rows
+  * @param     a, lda - Column-major buffer of A and distance between its columns
+  * @param     c, ldc - Column-major buffer of C, which has to be zeroed
+  * @details   Column x of C is sum of the columns of A scaled by the nonzeros in column x of S,
+  * @details   so both A and C are streamed by whole columns. Threads split the columns of S.
+  */
+  static void DenseMultiply(const double * a, int lda, int m, const SparseMatrix& s, double * c, int ldc,
+                            ThreadPool * pool = nullptr);
+};
+
+
+#endif
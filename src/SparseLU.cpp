@@ -0,0 +1,367 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include "SparseLU.h"
+
+SparseLU::SparseLU(const SparseMatrix& m) : size(m.GetWidth()), factorized(false)
+{
+  if (m.GetWidth() != m.GetHeight())
+    std::__throw_invalid_argument("Not a square matrix!");
+  rowPtr.assign(m.GetRowPointers(), m.GetRowPointers() + size + 1);
+  colIdx.assign(m.GetColumnIndices(), m.GetColumnIndices() + rowPtr[size]);
+
+  // Graph of A + A^T: row y merged with column y, both sorted
+  const int * colPtr = m.GetColumnPointers();
+  const int * rowIdx = m.GetRowIndices();
+  std::vector<int> adjPtr(size + 1, 0);
+  std::vector<int> adj;
+  adj.reserve(2 * colIdx.size());
+  for (int y = 0; y < size; ++y)
+  {
+    int i = rowPtr[y];
+    int j = colPtr[y];
+    while (i < rowPtr[y + 1] || j < colPtr[y + 1])
+    {
+      int next;
+      if (j == colPtr[y + 1] || (i < rowPtr[y + 1] && colIdx[i] < rowIdx[j]))
+        next = colIdx[i++];
+      else if (i == rowPtr[y + 1] || rowIdx[j] < colIdx[i])
+        next = rowIdx[j++];
+      else
+      {
+        next = colIdx[i++];
+        j++;
+      }
+      if (next != y)
+        adj.push_back(next);
+    }
+    adjPtr[y + 1] = adj.size();
+  }
+  Order(adjPtr, adj);
+  Analyze(adjPtr, adj);
+  factorized = Factorize(m);
+}
+
+void SparseLU::Order(const std::vector<int>& adjPtr, const std::vector<int>& adj)
+{
+  std::vector<int> degree(size);
+  for (int v = 0; v < size; ++v)
+    degree[v] = adjPtr[v + 1] - adjPtr[v];
+  // Every vertex belongs to a subgraph with a label, separators already ordered have label -1
+  std::vector<int> label(size, 0);
+  std::vector<int> level(size, -1);
+  int labels = 1;
+  // Breadth-first search from root within its subgraph, vertices are appended to queue with their level
+  auto search = [&](int root, std::vector<int>& queue)
+  {
+    queue.clear();
+    queue.push_back(root);
+    level[root] = 0;
+    for (size_t head = 0; head < queue.size(); ++head)
+    {
+      int v = queue[head];
+      for (int i = adjPtr[v]; i < adjPtr[v + 1]; ++i)
+        if (label[adj[i]] == label[root] && level[adj[i]] == -1)
+        {
+          level[adj[i]] = level[v] + 1;
+          queue.push_back(adj[i]);
+        }
+    }
+  };
+  auto clear = [&](const std::vector<int>& queue)
+  {
+    for (int v:queue)
+      level[v] = -1;
+  };
+
+  perm.clear();
+  perm.reserve(size);
+  std::vector<int> queue;
+  // Parts waiting for dissection, separators (marked true) wait below their parts, which are ordered first
+  std::vector<std::pair<std::vector<int>, bool>> stack;
+  stack.emplace_back(std::vector<int>(size), false);
+  for (int v = 0; v < size; ++v)
+    stack.back().first[v] = v;
+  while (!stack.empty())
+  {
+    std::vector<int> part = std::move(stack.back().first);
+    bool separator = stack.back().second;
+    stack.pop_back();
+    if (separator || (int) part.size() <= DISSECTIONLIMIT)
+    {
+      perm.insert(perm.end(), part.begin(), part.end());
+      continue;
+    }
+    int root = part[0];
+    search(root, queue);
+    if (queue.size() < part.size())
+    {
+      // Disconnected, every component is dissected on its own
+      clear(queue);
+      int old = label[root];
+      for (int v:part)
+        if (label[v] == old)
+        {
+          search(v, queue);
+          int component = labels++;
+          for (int u:queue)
+            label[u] = component;
+          clear(queue);
+          stack.emplace_back(queue, false);
+        }
+      continue;
+    }
+    // Pseudo-peripheral vertex (George-Liu): start of the deepest level structure found
+    int depth = level[queue.back()];
+    for (int tries = 0; tries < 8; ++tries)
+    {
+      int candidate = queue.back();
+      for (int v:queue)
+        if (level[v] == depth && degree[v] < degree[candidate])
+          candidate = v;
+      clear(queue);
+      search(candidate, queue);
+      int candidateDepth = level[queue.back()];
+      if (candidateDepth <= depth)
+        break;
+      root = candidate;
+      depth = candidateDepth;
+    }
+    clear(queue);
+    search(root, queue);
+    if (depth < 2)
+    {
+      clear(queue);
+      perm.insert(perm.end(), part.begin(), part.end());
+      continue;
+    }
+    // Middle level separates the levels below from the levels above
+    int middle = depth / 2;
+    int below = labels++;
+    int above = labels++;
+    std::vector<int> first, second, middleLevel;
+    for (int v:queue)
+    {
+      if (level[v] < middle)
+      {
+        label[v] = below;
+        first.push_back(v);
+      }
+      else if (level[v] > middle)
+      {
+        label[v] = above;
+        second.push_back(v);
+      }
+      else
+      {
+        label[v] = -1;
+        middleLevel.push_back(v);
+      }
+    }
+    clear(queue);
+    stack.emplace_back(std::move(middleLevel), true);
+    stack.emplace_back(std::move(second), false);
+    stack.emplace_back(std::move(first), false);
+  }
+  permInv.resize(size);
+  for (int k = 0; k < size; ++k)
+    permInv[perm[k]] = k;
+}
+
+void SparseLU::Analyze(const std::vector<int>& adjPtr, const std::vector<int>& adj)
+{
+  // Elimination tree of the ordered pattern
+  std::vector<int> parent(size, -1);
+  std::vector<int> ancestor(size, -1);
+  for (int k = 0; k < size; ++k)
+  {
+    int v = perm[k];
+    for (int i = adjPtr[v]; i < adjPtr[v + 1]; ++i)
+    {
+      int next;
+      for (int j = permInv[adj[i]]; j != -1 && j < k; j = next)
+      {
+        next = ancestor[j];
+        ancestor[j] = k;
+        if (next == -1)
+          parent[j] = k;
+      }
+    }
+  }
+
+  // Row k of L has nonzeros in the subtree of k, which is reached from the nonzeros of row k of A
+  std::vector<int> mark(size, -1);
+  auto reach = [&](int k, int * out)
+  {
+    long long count = 0;
+    mark[k] = k;
+    int v = perm[k];
+    for (int i = adjPtr[v]; i < adjPtr[v + 1]; ++i)
+      for (int j = permInv[adj[i]]; j < k && mark[j] != k; j = parent[j])
+      {
+        mark[j] = k;
+        if (out)
+          out[count] = j;
+        count++;
+      }
+    return count;
+  };
+  patternPtr.assign(size + 1, 0);
+  for (int k = 0; k < size; ++k)
+    patternPtr[k + 1] = patternPtr[k] + reach(k, nullptr);
+  pattern.resize(patternPtr[size]);
+  std::fill(mark.begin(), mark.end(), -1);
+  for (int k = 0; k < size; ++k)
+  {
+    reach(k, pattern.data() + patternPtr[k]);
+    std::sort(pattern.begin() + patternPtr[k], pattern.begin() + patternPtr[k + 1]);
+  }
+}
+
+bool SparseLU::Factorize(const SparseMatrix& m)
+{
+  const int * aPtr = m.GetRowPointers();
+  const int * aIdx = m.GetColumnIndices();
+  const double * aVal = m.GetValues();
+  const int * colPtr = m.GetColumnPointers();
+  const int * rowIdx = m.GetRowIndices();
+  const int * colPos = m.GetColumnPositions();
+  double epsilon = std::numeric_limits<double>::epsilon() * size;
+
+  lower.assign(pattern.size(), 0);
+  upper.assign(pattern.size(), 0);
+  diagonal.assign(size, 0);
+  // x is column k of U, y is row k of L, both scattered from A and solved in place
+  std::vector<double> x(size, 0);
+  std::vector<double> y(size, 0);
+  for (int k = 0; k < size; ++k)
+  {
+    int v = perm[k];
+    double diag = 0;
+    // pivot is compared with the largest element of its row and of its column of A, whichever is smaller,
+    // products subtracted from it with the larger one, since rows aren't swapped to limit their growth
+    double rowScale = 0;
+    double columnScale = 0;
+    double growth = 0;
+    for (int i = aPtr[v]; i < aPtr[v + 1]; ++i)
+    {
+      int j = permInv[aIdx[i]];
+      rowScale = std::max(rowScale, std::fabs(aVal[i]));
+      if (j < k)
+        y[j] = aVal[i];
+      else if (j == k)
+        diag = aVal[i];
+    }
+    for (int i = colPtr[v]; i < colPtr[v + 1]; ++i)
+    {
+      int j = permInv[rowIdx[i]];
+      columnScale = std::max(columnScale, std::fabs(aVal[colPos[i]]));
+      if (j < k)
+        x[j] = aVal[colPos[i]];
+    }
+    for (long long p = patternPtr[k]; p < patternPtr[k + 1]; ++p)
+    {
+      int i = pattern[p];
+      double u = x[i];
+      double l = y[i];
+      for (long long q = patternPtr[i]; q < patternPtr[i + 1]; ++q)
+      {
+        int j = pattern[q];
+        u -= lower[q] * x[j];
+        l -= y[j] * upper[q];
+      }
+      l /= diagonal[i];
+      x[i] = upper[p] = u;
+      y[i] = lower[p] = l;
+      diag -= l * u;
+      growth = std::max(growth, std::fabs(l * u));
+    }
+    for (long long p = patternPtr[k]; p < patternPtr[k + 1]; ++p)
+      x[pattern[p]] = y[pattern[p]] = 0;
+    if (!(std::fabs(diag) > epsilon * std::min(rowScale, columnScale))
+        || growth > GROWTHLIMIT * std::max(rowScale, columnScale))
+      return false;
+    diagonal[k] = diag;
+  }
+  return true;
+}
+
+bool SparseLU::SamePattern(const SparseMatrix& m) const
+{
+  if (m.GetWidth() != size || m.GetHeight() != size)
+    return false;
+  const int * ptr = m.GetRowPointers();
+  const int * idx = m.GetColumnIndices();
+  return std::equal(rowPtr.begin(), rowPtr.end(), ptr) && std::equal(colIdx.begin(), colIdx.end(), idx);
+}
+
+bool SparseLU::Refactor(const SparseMatrix& m)
+{
+  if (!SamePattern(m))
+    std::__throw_invalid_argument("Pattern doesn't match!");
+  factorized = Factorize(m);
+  return factorized;
+}
+
+bool SparseLU::IsFactorized() const
+{
+  return factorized;
+}
+
+long long SparseLU::GetFillCount() const
+{
+  return 2 * (long long) pattern.size() + size;
+}
+
+double SparseLU::Determinant() const
+{
+  if (!factorized)
+    return 0;
+  double determinant = 1;
+  for (int k = 0; k < size; ++k)
+    determinant *= diagonal[k];
+  return determinant;
+}
+
+void SparseLU::Solve(double * b, int ldb, int nrhs, ThreadPool * pool) const
+{
+  if (!factorized)
+    std::__throw_invalid_argument("Matrix isn't invertible!");
+  int parts = 1;
+  if (pool && nrhs > 1)
+    parts = std::min(nrhs, pool->GetThreadCount());
+  auto solve = [&](int part)
+  {
+    std::vector<double> w(size);
+    for (int j = (long) nrhs * part / parts; j < (long) nrhs * (part + 1) / parts; ++j)
+    {
+      double * rhs = b + (size_t) j * ldb;
+      for (int k = 0; k < size; ++k)
+        w[k] = rhs[perm[k]];
+      // L * z = P * b, row by row
+      for (int k = 0; k < size; ++k)
+      {
+        double sum = w[k];
+        for (long long p = patternPtr[k]; p < patternPtr[k + 1]; ++p)
+          sum -= lower[p] * w[pattern[p]];
+        w[k] = sum;
+      }
+      // U * x = z, column by column
+      for (int k = size - 1; k >= 0; --k)
+      {
+        w[k] /= diagonal[k];
+        double val = w[k];
+        if (val != 0)
+          for (long long p = patternPtr[k]; p < patternPtr[k + 1]; ++p)
+            w[pattern[p]] -= upper[p] * val;
+      }
+      for (int k = 0; k < size; ++k)
+        rhs[perm[k]] = w[k];
+    }
+  };
+  if (pool)
+    pool->Run(parts, solve);
+  else
+    solve(0);
+}
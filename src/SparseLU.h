@@ -0,0 +1,122 @@
+/**
+* @file         SparseLU.h
+* @date         18.10.2026
+* @brief        Definition of the SparseLU
+* @author       miklilad
+*/
+#ifndef SEM_SPARSELU_H
+#define SEM_SPARSELU_H
+
+#include <vector>
+#include "SparseMatrix.h"
+#include "ThreadPool.h"
+
+/**
+* @class    SparseLU
+* @brief    Sparse LU factorization P * A * P^T = L * U of a square SparseMatrix
+* @details  Nested dissection ordering P of the graph of A + A^T keeps the fill-in low: the graph is split
+* @details  by the middle level of a breadth-first search, both halves are ordered first, the separator last.
+* @details  Symbolic analysis builds the elimination tree of the ordered pattern and the exact
+* @details  pattern of L from it, U has the transposed pattern of L. Numeric phase computes one row
+* @details  of L and one column of U at a time by sparse triangular solves (up-looking).
+* @details  Rows aren't pivoted, so the factorization suits diagonally dominant and symmetric positive
+* @details  definite systems. The factorization stops and IsFactorized returns false on a pivot up to
+* @details  size * epsilon times the largest element of its row or column of A, whichever is smaller,
+* @details  or when a product l * u subtracted from the pivot exceeds GROWTHLIMIT times the larger one,
+* @details  so that the caller can use a pivoted dense factorization instead.
+* @details  Numeric phase can be repeated by Refactor for matricies with the same pattern.
+*/
+class SparseLU
+{
+  /**
+  * Largest part of the graph, which isn't dissected further
+  */
+  static const int DISSECTIONLIMIT = 64;
+
+  /**
+  * Largest ratio of a product l * u subtracted from a pivot to the elements of its row and column of A
+  */
+  static constexpr double GROWTHLIMIT = 1e6;
+
+  int size;
+  std::vector<int> perm;
+  std::vector<int> permInv;
+  std::vector<long long> patternPtr;
+  std::vector<int> pattern;
+  std::vector<double> lower;
+  std::vector<double> upper;
+  std::vector<double> diagonal;
+  std::vector<int> rowPtr;
+  std::vector<int> colIdx;
+  bool factorized;
+
+  /**
+  * @fn        Order
+  * @brief     Computes perm by nested dissection of the graph of A + A^T
+  * @param     adjPtr, adj - Neighbours of every vertex (without itself)
+  */
+  void Order(const std::vector<int>& adjPtr, const std::vector<int>& adj);
+
+  /**
+  * @fn        Analyze
+  * @brief     Computes the elimination tree and the pattern of every row of L in the new order
+  */
+  void Analyze(const std::vector<int>& adjPtr, const std::vector<int>& adj);
+
+  /**
+  * @fn        Factorize
+  * @brief     Numeric phase, fills lower, upper and diagonal
+  * @returns   False, if a pivot was too close to zero
+  */
+  bool Factorize(const SparseMatrix& m);
+
+public:
+  /**
+  * @brief     Orders, analyzes and factorizes m
+  * @details   Throws std::invalid_argument for matrix, which isn't square.
+  */
+  explicit SparseLU(const SparseMatrix& m);
+
+  /**
+  * @fn        SamePattern
+  * @returns   True, if m has the same size and nonzero positions as the factorized matrix
+  */
+  bool SamePattern(const SparseMatrix& m) const;
+
+  /**
+  * @fn        Refactor
+  * @brief     Repeats only the numeric phase with the values of m, ordering and analysis are reused
+  * @details   Throws std::invalid_argument, if m doesn't have the same pattern.
+  * @returns   IsFactorized()
+  */
+  bool Refactor(const SparseMatrix& m);
+
+  /**
+  * @fn        IsFactorized
+  * @returns   True, if the last numeric phase didn't break down
+  */
+  bool IsFactorized() const;
+
+  /**
+  * @fn        GetFillCount
+  * @returns   Number of stored elements of L and U together with the diagonal
+  */
+  long long GetFillCount() const;
+
+  /**
+  * @fn        Determinant
+  * @returns   Determinant of the factorized matrix
+  */
+  double Determinant() const;
+
+  /**
+  * @fn        Solve
+  * @brief     Overwrites columns of B by solution of A * X = B
+  * @param     b, ldb - Column-major buffer of B with nrhs columns and distance between them
+  * @param     pool - Workers to split the columns of B among, nullptr to run in the calling thread
+  */
+  void Solve(double * b, int ldb, int nrhs, ThreadPool * pool = nullptr) const;
+};
+
+
+#endif
@@ -1,62 +1,338 @@
+#include <stdexcept>
 #include "SparseMatrix.h"
 
+SparseMatrix::SparseMatrix(int width, int height) : Matrix(width, height), storage(std::make_shared<Storage>()),
+                                                    transposed(false)
+{
+  storage->rowPtr.assign(height + 1, 0);
+}
+
+SparseMatrix::SparseMatrix(int width, int height, std::vector<int> rowPtr, std::vector<int> colIdx,
+                           std::vector<double> values) : Matrix(width, height), storage(std::make_shared<Storage>()),
+                                                         transposed(false)
+{
+  if ((int) rowPtr.size() != height + 1 || colIdx.size() != values.size() || rowPtr[height] != (int) values.size())
+    throw std::exception();
+  storage->rowPtr = std::move(rowPtr);
+  storage->colIdx = std::move(colIdx);
+  storage->values = std::move(values);
+}
+
+void SparseMatrix::Detach()
+{
+  if (IsShared())
+    storage = std::make_shared<Storage>(*storage);
+}
+
+bool SparseMatrix::IsShared() const
+{
+  return storage.use_count() > 1;
+}
+
+bool SparseMatrix::IsTransposed() const
+{
+  return transposed;
+}
+
+int SparseMatrix::Find(int x, int y) const
+{
+  const auto begin = storage->colIdx.begin() + storage->rowPtr[y];
+  const auto end = storage->colIdx.begin() + storage->rowPtr[y + 1];
+  const auto it = std::lower_bound(begin, end, x);
+  if (it == end || *it != x)
+    return -1;
+  return it - storage->colIdx.begin();
+}
+
 double SparseMatrix::At(int x, int y) const
 {
-  dataPoint point = {x, y, 0};
-  const auto& it = std::lower_bound(data.begin(), data.end(), point, Compare);
-  if (it == data.end())
-    return 0;
-  if (it->x == x && it->y == y)
-    return it->num;
-  else
+  int pos = transposed ? Find(y, x) : Find(x, y);
+  if (pos == -1)
     return 0;
+  return storage->values[pos];
 }
 
-bool SparseMatrix::Compare(const SparseMatrix::dataPoint& d1, const SparseMatrix::dataPoint& d2)
+void SparseMatrix::SetAt(int x, int y, double val)
 {
-  if (d1.x == d2.x)
-    return d1.y < d2.y;
-  return d1.x < d2.x;
+  Detach();
+  if (transposed)
+    std::swap(x, y);
+  const auto begin = storage->colIdx.begin() + storage->rowPtr[y];
+  const auto end = storage->colIdx.begin() + storage->rowPtr[y + 1];
+  const auto it = std::lower_bound(begin, end, x);
+  int pos = it - storage->colIdx.begin();
+  if (it != end && *it == x)
+  {
+    storage->values[pos] = val;
+    return;
+  }
+  if (val == 0)
+    return;
+  storage->colIdx.insert(it, x);
+  storage->values.insert(storage->values.begin() + pos, val);
+  for (int i = y + 1; i < (int) storage->rowPtr.size(); ++i)
+    storage->rowPtr[i]++;
+  storage->columnsValid = false;
 }
 
-void SparseMatrix::SetAt(int x, int y, double val)
+Matrix * SparseMatrix::GetCopy() const
 {
-  dataPoint point = {x, y, val};
-  const auto& it = std::lower_bound(data.begin(), data.end(), point, Compare);
-  if (it == data.end())
-    data.push_back(point);
-  else if (it->x == x && it->y == y)
-    it->num = val;
+  return new SparseMatrix(*this);
+}
+
+void SparseMatrix::Transpose()
+{
+  transposed = !transposed;
+  int num = width;
+  width = height;
+  height = num;
+}
+
+void SparseMatrix::Materialize() const
+{
+  if (!transposed)
+    return;
+  BuildColumns();
+  std::shared_ptr<Storage> result = storage;
+  // the CSC index of shared storage becomes CSR of a new one, private storage is reused
+  if (IsShared())
+  {
+    result = std::make_shared<Storage>();
+    result->rowPtr = storage->colPtr;
+    result->colIdx = storage->rowIdx;
+  }
   else
-    data.insert(it, point);
+  {
+    result->rowPtr.swap(result->colPtr);
+    result->colIdx.swap(result->rowIdx);
+  }
+  std::vector<double> values(storage->values.size());
+  for (size_t i = 0; i < values.size(); ++i)
+    values[i] = storage->values[storage->colPos[i]];
+  result->values.swap(values);
+  result->columnsValid = false;
+  storage = result;
+  transposed = false;
 }
 
-Matrix * SparseMatrix::GetCopy() const
+void SparseMatrix::BuildColumns() const
+{
+  if (storage->columnsValid)
+    return;
+  int columns = transposed ? height : width;
+  int rows = transposed ? width : height;
+  int nnz = storage->values.size();
+  storage->colPtr.assign(columns + 1, 0);
+  storage->rowIdx.resize(nnz);
+  storage->colPos.resize(nnz);
+  for (int i = 0; i < nnz; ++i)
+    storage->colPtr[storage->colIdx[i] + 1]++;
+  for (int x = 0; x < columns; ++x)
+    storage->colPtr[x + 1] += storage->colPtr[x];
+  std::vector<int> next(storage->colPtr.begin(), storage->colPtr.end() - 1);
+  for (int y = 0; y < rows; ++y)
+  {
+    for (int i = storage->rowPtr[y]; i < storage->rowPtr[y + 1]; ++i)
+    {
+      int dest = next[storage->colIdx[i]]++;
+      storage->rowIdx[dest] = y;
+      storage->colPos[dest] = i;
+    }
+  }
+  storage->columnsValid = true;
+}
+
+long long SparseMatrix::GetNonZeroCount() const
+{
+  return storage->values.size();
+}
+
+const int * SparseMatrix::GetRowPointers() const
+{
+  Materialize();
+  return storage->rowPtr.data();
+}
+
+const int * SparseMatrix::GetColumnIndices() const
+{
+  Materialize();
+  return storage->colIdx.data();
+}
+
+const double * SparseMatrix::GetValues() const
+{
+  Materialize();
+  return storage->values.data();
+}
+
+double * SparseMatrix::GetValues()
+{
+  Materialize();
+  Detach();
+  return storage->values.data();
+}
+
+const int * SparseMatrix::GetColumnPointers() const
+{
+  Materialize();
+  BuildColumns();
+  return storage->colPtr.data();
+}
+
+const int * SparseMatrix::GetRowIndices() const
+{
+  Materialize();
+  BuildColumns();
+  return storage->rowIdx.data();
+}
+
+const int * SparseMatrix::GetColumnPositions() const
+{
+  Materialize();
+  BuildColumns();
+  return storage->colPos.data();
+}
+
+SparseMatrix::RowSpan SparseMatrix::GetRowSpan(int y) const
+{
+  Materialize();
+  const int * rowPtr = storage->rowPtr.data();
+  return {storage->colIdx.data() + rowPtr[y], storage->values.data() + rowPtr[y], rowPtr[y + 1] - rowPtr[y]};
+}
+
+void SparseMatrix::SwapRows(int row1, int row2)
+{
+  if (row1 >= height || row2 >= height || row1 < 0 || row2 < 0)
+    throw std::exception();
+  Materialize();
+  if (row1 == row2)
+  {
+    Detach();
+    for (int i = storage->rowPtr[row1]; i < storage->rowPtr[row1 + 1]; ++i)
+      storage->values[i] = -storage->values[i];
+    return;
+  }
+  std::vector<int> newPtr(height + 1, 0);
+  std::vector<int> newIdx(storage->colIdx.size());
+  std::vector<double> newValues(storage->values.size());
+  int stored = 0;
+  for (int y = 0; y < height; ++y)
+  {
+    int from = y == row1 ? row2 : y == row2 ? row1 : y;
+    double sign = y == row2 ? -1 : 1;
+    newPtr[y] = stored;
+    for (int i = storage->rowPtr[from]; i < storage->rowPtr[from + 1]; ++i)
+    {
+      newIdx[stored] = storage->colIdx[i];
+      newValues[stored] = storage->values[i] != 0 ? sign * storage->values[i] : 0;
+      stored++;
+    }
+  }
+  newPtr[height] = stored;
+  // rows are rebuilt anyway, so shared storage isn't copied first
+  if (IsShared())
+    storage = std::make_shared<Storage>();
+  storage->rowPtr.swap(newPtr);
+  storage->colIdx.swap(newIdx);
+  storage->values.swap(newValues);
+  storage->columnsValid = false;
+}
+
+void SparseMatrix::ScalarMul(double num)
 {
-  Matrix * copy = new SparseMatrix(width, height);
+  Detach();
+  for (auto& val:storage->values)
+    val *= num;
+}
+
+void SparseMatrix::CopyTo(double * buffer, int ld) const
+{
+  for (int x = 0; x < width; ++x)
+    std::fill(buffer + (size_t) x * ld, buffer + (size_t) x * ld + height, 0.0);
+  // rows of transposed storage are the columns of the matrix
+  int rows = transposed ? width : height;
+  for (int r = 0; r < rows; ++r)
+    for (int i = storage->rowPtr[r]; i < storage->rowPtr[r + 1]; ++i)
+    {
+      if (transposed)
+        buffer[(size_t) r * ld + storage->colIdx[i]] = storage->values[i];
+      else
+        buffer[(size_t) storage->colIdx[i] * ld + r] = storage->values[i];
+    }
+}
+
+void SparseMatrix::FillFrom(const double * buffer, int ld)
+{
+  if (IsShared() || transposed)
+    storage = std::make_shared<Storage>();
+  transposed = false;
+  storage->rowPtr.assign(height + 1, 0);
+  storage->colIdx.clear();
+  storage->values.clear();
   for (int y = 0; y < height; ++y)
   {
     for (int x = 0; x < width; ++x)
-      copy->SetAt(x, y, At(x, y));
+    {
+      double val = buffer[(size_t) x * ld + y];
+      if (val != 0)
+      {
+        storage->colIdx.push_back(x);
+        storage->values.push_back(val);
+      }
+    }
+    storage->rowPtr[y + 1] = storage->values.size();
   }
-  return copy;
+  storage->columnsValid = false;
 }
 
-SparseMatrix::SparseMatrix(int width, int height) : Matrix(width, height)
+void SparseMatrix::StoredRowTo(int y, double * buffer, int length) const
 {
+  std::fill(buffer, buffer + length, 0.0);
+  for (int i = storage->rowPtr[y]; i < storage->rowPtr[y + 1]; ++i)
+    buffer[storage->colIdx[i]] = storage->values[i];
+}
 
+void SparseMatrix::StoredColumnTo(int x, double * buffer, int length) const
+{
+  BuildColumns();
+  std::fill(buffer, buffer + length, 0.0);
+  for (int i = storage->colPtr[x]; i < storage->colPtr[x + 1]; ++i)
+    buffer[storage->rowIdx[i]] = storage->values[storage->colPos[i]];
 }
 
-void SparseMatrix::Transpose()
+void SparseMatrix::CopyRowTo(int y, double * buffer) const
+{
+  if (transposed)
+    StoredColumnTo(y, buffer, width);
+  else
+    StoredRowTo(y, buffer, width);
+}
+
+void SparseMatrix::CopyColumnTo(int x, double * buffer) const
+{
+  if (transposed)
+    StoredRowTo(x, buffer, height);
+  else
+    StoredColumnTo(x, buffer, height);
+}
+
+long long SparseMatrix::ReadNonZeros(long long cursor, Entry * out, int max, int& count) const
 {
-  for (auto& point:data)
+  const std::vector<int>& rowPtr = storage->rowPtr;
+  long long nnz = storage->values.size();
+  count = 0;
+  if (cursor >= nnz)
+    return -1;
+  int y = std::upper_bound(rowPtr.begin(), rowPtr.end(), cursor) - rowPtr.begin() - 1;
+  while (cursor < nnz && count < max)
   {
-    int num = point.x;
-    point.x = point.y;
-    point.y = num;
+    while (rowPtr[y + 1] <= cursor)
+      y++;
+    double val = storage->values[cursor];
+    int x = storage->colIdx[cursor];
+    if (val != 0)
+      out[count++] = transposed ? Entry{y, x, val} : Entry{x, y, val};
+    cursor++;
   }
-  int num = width;
-  width = height;
-  height = num;
-  std::sort(data.begin(), data.end(), Compare);
+  return cursor < nnz ? cursor : -1;
 }
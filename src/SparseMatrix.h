@@ -9,29 +9,109 @@
 
 #include "Matrix.h"
 #include <vector>
+#include <memory>
 #include <algorithm>
 
 /**
 * @class    SparseMatrix
 * @brief    Efficient storage for sparse matricies
-* @details  Lighter but slower than DenseMatrix. Uses vector of dataPoint to store data.
+* @details  Lighter but slower than DenseMatrix. Stores data in compressed sparse row (CSR) format:
+* @details  nonzeros of row y are at positions rowPtr[y] .. rowPtr[y + 1] - 1 of colIdx (their column)
+* @details  and values (their value), sorted by column. That is 12 bytes per nonzero.
+* @details  Compressed column (CSC) index is built on demand for column iteration and is dropped,
+* @details  whenever the structure of the matrix changes.
+* @details  Copies share the arrays together with the CSC index (copy-on-write), they are duplicated
+* @details  by the first modification of a matrix, which doesn't own them alone.
+* @details  Transpose only marks the arrays as holding the transposed matrix, whose rows are the columns
+* @details  of this one. Element access, bulk copies and ScalarMul work on such storage directly,
+* @details  the CSR and CSC accessors and SwapRows first transpose it physically in O(nnz) using the CSC index.
 */
 class SparseMatrix : public Matrix
 {
-  struct dataPoint
+  /**
+  * @struct   Storage
+  * @brief    CSR arrays and the CSC index built from them
+  */
+  struct Storage
   {
-    int x, y;
-    double num;
+    std::vector<int> rowPtr;
+    std::vector<int> colIdx;
+    std::vector<double> values;
+
+    bool columnsValid = false;
+    std::vector<int> colPtr;
+    std::vector<int> rowIdx;
+    std::vector<int> colPos;
   };
 
-  std::vector<dataPoint> data;
+  mutable std::shared_ptr<Storage> storage;
+  mutable bool transposed;
 
-public:
+  /**
+  * @fn        Detach
+  * @brief     Makes a private copy of the storage, if it's shared with another matrix
+  */
+  void Detach();
+
+  /**
+  * @fn        Find
+  * @returns   Position of x,y in colIdx/values or -1, if it isn't stored
+  */
+  int Find(int x, int y) const;
+
+  /**
+  * @fn        BuildColumns
+  * @brief     Builds the CSC index, if it isn't valid
+  */
+  void BuildColumns() const;
 
-  static bool Compare(const dataPoint& d1, const dataPoint& d2);
+  /**
+  * @fn        Materialize
+  * @brief     Transposes the storage physically, if it holds the transposed matrix
+  */
+  void Materialize() const;
+
+  /**
+  * @fn        StoredRowTo
+  * @brief     Writes length elements of row y of the storage (as it is stored) to buffer
+  */
+  void StoredRowTo(int y, double * buffer, int length) const;
+
+  /**
+  * @fn        StoredColumnTo
+  * @brief     Writes length elements of column x of the storage (as it is stored) to buffer
+  */
+  void StoredColumnTo(int x, double * buffer, int length) const;
+
+public:
 
   SparseMatrix(int width, int height);
 
+  /**
+  * @brief     Creates the matrix directly from CSR arrays
+  * @details   Columns within each row have to be sorted and unique.
+  */
+  SparseMatrix(int width, int height, std::vector<int> rowPtr, std::vector<int> colIdx, std::vector<double> values);
+
+  /**
+  * @brief     Shares the storage of other, see the details of the class
+  */
+  SparseMatrix(const SparseMatrix& other) = default;
+
+  SparseMatrix& operator=(const SparseMatrix& other) = default;
+
+  /**
+  * @fn        IsShared
+  * @returns   True, if another matrix uses the same storage
+  */
+  bool IsShared() const;
+
+  /**
+  * @fn        IsTransposed
+  * @returns   True, if the storage holds the transposed matrix, see the details of the class
+  */
+  bool IsTransposed() const;
+
   double At(int x, int y) const override;
 
   void SetAt(int x, int y, double val) override;
@@ -40,6 +120,83 @@ public:
 
   void Transpose() override;
 
+  /**
+  * @fn        GetNonZeroCount
+  * @returns   Number of stored elements
+  */
+  long long GetNonZeroCount() const override;
+
+  /**
+  * @fn        GetRowPointers
+  * @returns   CSR row pointers, height + 1 elements
+  */
+  const int * GetRowPointers() const;
+
+  /**
+  * @fn        GetColumnIndices
+  * @returns   CSR column index of every stored element
+  */
+  const int * GetColumnIndices() const;
+
+  /**
+  * @fn        GetValues
+  * @returns   Value of every stored element in CSR order
+  * @details   The non-const version counts as a modification, see the details of the class.
+  */
+  const double * GetValues() const;
+  double * GetValues();
+
+  /**
+  * @fn        GetColumnPointers
+  * @returns   CSC column pointers, width + 1 elements
+  * @details   Nonzeros of column x are at positions GetColumnPointers()[x] .. GetColumnPointers()[x + 1] - 1
+  * @details   of GetRowIndices() and GetColumnPositions(), sorted by row.
+  */
+  const int * GetColumnPointers() const;
+
+  /**
+  * @fn        GetRowIndices
+  * @returns   CSC row index of every stored element
+  */
+  const int * GetRowIndices() const;
+
+  /**
+  * @fn        GetColumnPositions
+  * @returns   Position in GetValues() of every stored element in CSC order
+  */
+  const int * GetColumnPositions() const;
+
+  /**
+  * @struct   RowSpan
+  * @brief    Nonzeros of one row: index[i] is the column of values[i]
+  */
+  struct RowSpan
+  {
+    const int * index;
+    const double * values;
+    int size;
+  };
+
+  /**
+  * @fn        GetRowSpan
+  * @returns   View of nonzeros of y-th row
+  */
+  RowSpan GetRowSpan(int y) const;
+
+  void SwapRows(int row1, int row2) override;
+
+  void ScalarMul(double num) override;
+
+  void CopyTo(double * buffer, int ld) const override;
+
+  void FillFrom(const double * buffer, int ld) override;
+
+  void CopyRowTo(int y, double * buffer) const override;
+
+  void CopyColumnTo(int x, double * buffer) const override;
+
+  long long ReadNonZeros(long long cursor, Entry * out, int max, int& count) const override;
+
 };
 
 
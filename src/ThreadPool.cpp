@@ -0,0 +1,139 @@
+#include <algorithm>
+#include "ThreadPool.h"
+
+namespace
+{
+  thread_local bool insideTask = false;
+
+  /**
+  * @struct   TaskScope
+  * @brief    Marks the thread as inside a task, until the scope is left
+  */
+  struct TaskScope
+  {
+    TaskScope()
+    {
+      insideTask = true;
+    }
+
+    ~TaskScope()
+    {
+      insideTask = false;
+    }
+  };
+}
+
+ThreadPool::ThreadPool(int threads) : job(nullptr), generation(0), stop(false)
+{
+  Start(threads);
+}
+
+ThreadPool::~ThreadPool()
+{
+  Stop();
+}
+
+void ThreadPool::Start(int count)
+{
+  if (count <= 0)
+    count = std::max(1u, std::thread::hardware_concurrency());
+  stop = false;
+  for (int i = 1; i < count; ++i)
+    workers.emplace_back(&ThreadPool::Work, this);
+}
+
+void ThreadPool::Stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  wake.notify_all();
+  for (auto& worker:workers)
+    worker.join();
+  workers.clear();
+}
+
+void ThreadPool::Resize(int threads)
+{
+  Stop();
+  Start(threads);
+}
+
+int ThreadPool::GetThreadCount() const
+{
+  return workers.size() + 1;
+}
+
+void ThreadPool::Work()
+{
+  long seen = 0;
+  while (true)
+  {
+    Job * current;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [&] { return stop || (job != nullptr && generation != seen); });
+      if (stop)
+        return;
+      seen = generation;
+      current = job;
+      current->active++;
+    }
+    Drain(*current);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      current->active--;
+    }
+    finished.notify_all();
+  }
+}
+
+void ThreadPool::Drain(Job& job)
+{
+  TaskScope scope;
+  int i;
+  while ((i = job.next++) < job.count)
+  {
+    try
+    {
+      (*job.task)(i);
+    }
+    catch (...)
+    {
+      // only the first exception is kept, the tasks not started yet are skipped
+      if (!job.failed.exchange(true))
+        job.error = std::current_exception();
+      job.next = job.count;
+    }
+  }
+}
+
+void ThreadPool::Run(int count, const std::function<void(int)>& task)
+{
+  if (workers.empty() || count <= 1 || insideTask)
+  {
+    for (int i = 0; i < count; ++i)
+      task(i);
+    return;
+  }
+  Job current;
+  current.task = &task;
+  current.count = count;
+  current.next = 0;
+  current.active = 0;
+  current.failed = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    job = &current;
+    generation++;
+  }
+  wake.notify_all();
+  Drain(current);
+  std::unique_lock<std::mutex> lock(mutex);
+  finished.wait(lock, [&] { return current.active == 0; });
+  job = nullptr;
+  lock.unlock();
+  if (current.error)
+    std::rethrow_exception(current.error);
+}
@@ -0,0 +1,110 @@
+/**
+* @file         ThreadPool.h
+* @date         18.10.2026
+* @brief        Definition of the ThreadPool
+* @author       miklilad
+*/
+#ifndef SEM_THREADPOOL_H
+#define SEM_THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+
+/**
+* @class    ThreadPool
+* @brief    Persistent worker threads for parallel kernels
+* @details  Workers are created once and sleep between jobs. A job is a number of independent
+* @details  tasks, which are handed out dynamically to the workers and to the calling thread.
+* @details  Run called from inside a task executes the tasks serially.
+* @details  An exception thrown by a task skips the tasks not started yet and is rethrown by Run,
+* @details  once all the threads have left the job.
+*/
+class ThreadPool
+{
+  /**
+  * @struct   Job
+  * @brief    Tasks of one Run call
+  */
+  struct Job
+  {
+    const std::function<void(int)> * task;
+    int count;
+    std::atomic<int> next;
+    int active;
+    std::atomic<bool> failed;
+    std::exception_ptr error;
+  };
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable finished;
+
+  Job * job;
+  long generation;
+  bool stop;
+
+  /**
+  * @fn        Work
+  * @brief     Main loop of a worker thread
+  */
+  void Work();
+
+  /**
+  * @fn        Drain
+  * @brief     Executes tasks of the job, until there are none left
+  * @details   The first exception of a task is saved to the job instead of leaving the thread.
+  */
+  static void Drain(Job& job);
+
+  /**
+  * @fn        Start
+  * @brief     Starts count - 1 workers
+  */
+  void Start(int count);
+
+  /**
+  * @fn        Stop
+  * @brief     Stops and joins all workers
+  */
+  void Stop();
+
+public:
+  /**
+  * @param     threads - Number of threads including the caller, 0 for number of cores
+  */
+  explicit ThreadPool(int threads = 0);
+
+  ThreadPool(const ThreadPool&) = delete;
+
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+  * @fn        Resize
+  * @brief     Changes the number of threads, 0 for number of cores
+  */
+  void Resize(int threads);
+
+  /**
+  * @fn        GetThreadCount
+  * @returns   Number of threads including the caller
+  */
+  int GetThreadCount() const;
+
+  /**
+  * @fn        Run
+  * @brief     Calls task(i) for every i in 0 .. count - 1 and waits for all of them
+  * @details   Rethrows the first exception thrown by a task.
+  */
+  void Run(int count, const std::function<void(int)>& task);
+
+  ~ThreadPool();
+};
+
+
+#endif
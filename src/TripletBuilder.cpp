@@ -0,0 +1,112 @@
+#include <stdexcept>
+#include "TripletBuilder.h"
+
+TripletBuilder::TripletBuilder(int width, int height) : width(width), height(height), nonZeros(0)
+{
+  if (width < 1 || height < 1)
+    throw std::exception();
+}
+
+void TripletBuilder::Reserve(size_t count)
+{
+  xs.reserve(count);
+  ys.reserve(count);
+  vals.reserve(count);
+}
+
+void TripletBuilder::Add(int x, int y, double val)
+{
+  if (val != 0)
+    nonZeros++;
+  xs.push_back(x);
+  ys.push_back(y);
+  vals.push_back(val);
+}
+
+int TripletBuilder::GetCount() const
+{
+  return vals.size();
+}
+
+SparseMatrix * TripletBuilder::Build()
+{
+  int count = vals.size();
+
+  // Stable counting sort by column first, then by row, gives row-major order
+  // in which repeated positions keep the order they were added in
+  std::vector<int> byColumn(count);
+  std::vector<int> next(width + 1, 0);
+  for (int i = 0; i < count; ++i)
+    next[xs[i] + 1]++;
+  for (int x = 0; x < width; ++x)
+    next[x + 1] += next[x];
+  for (int i = 0; i < count; ++i)
+    byColumn[next[xs[i]]++] = i;
+
+  std::vector<int> rowPtr(height + 1, 0);
+  for (int i = 0; i < count; ++i)
+    rowPtr[ys[i] + 1]++;
+  for (int y = 0; y < height; ++y)
+    rowPtr[y + 1] += rowPtr[y];
+  std::vector<int> colIdx(count);
+  std::vector<double> values(count);
+  next.assign(rowPtr.begin(), rowPtr.end() - 1);
+  for (int i:byColumn)
+  {
+    int dest = next[ys[i]]++;
+    colIdx[dest] = xs[i];
+    values[dest] = vals[i];
+  }
+
+  int stored = 0;
+  for (int y = 0; y < height; ++y)
+  {
+    int begin = rowPtr[y];
+    rowPtr[y] = stored;
+    for (int i = begin; i < rowPtr[y + 1]; ++i)
+    {
+      // only the last value of a position is kept and it's dropped, if it's zero
+      if ((i + 1 < rowPtr[y + 1] && colIdx[i + 1] == colIdx[i]) || values[i] == 0)
+        continue;
+      colIdx[stored] = colIdx[i];
+      values[stored] = values[i];
+      stored++;
+    }
+  }
+  rowPtr[height] = stored;
+  colIdx.resize(stored);
+  values.resize(stored);
+
+  xs.clear();
+  ys.clear();
+  vals.clear();
+  nonZeros = 0;
+  return new SparseMatrix(width, height, std::move(rowPtr), std::move(colIdx), std::move(values));
+}
+
+DenseMatrix * TripletBuilder::BuildDense()
+{
+  DenseMatrix * dense = new DenseMatrix(width, height);
+  for (size_t i = 0; i < vals.size(); ++i)
+    dense->SetAt(xs[i], ys[i], vals[i]);
+  xs.clear();
+  ys.clear();
+  vals.clear();
+  nonZeros = 0;
+  return dense;
+}
+
+Matrix * TripletBuilder::BuildPreferred()
+{
+  if (PreferSparse(width, height, nonZeros))
+    return Build();
+  return BuildDense();
+}
+
+bool TripletBuilder::PreferSparse(int width, int height, long long nonZeros)
+{
+  double zeroCount = (double) width * height - nonZeros;
+  double referenceRatio = (double) (sizeof(double) + 2 * sizeof(int)) / sizeof(double);
+  double ratio = (double) width * height / zeroCount;
+  return ratio < referenceRatio;
+}
@@ -0,0 +1,82 @@
+/**
+* @file         TripletBuilder.h
+* @date         18.10.2026
+* @brief        Definition of the TripletBuilder
+* @author       miklilad
+*/
+#ifndef SEM_TRIPLETBUILDER_H
+#define SEM_TRIPLETBUILDER_H
+
+#include <vector>
+#include "SparseMatrix.h"
+#include "DenseMatrix.h"
+
+/**
+* @class    TripletBuilder
+* @brief    Collects (x, y, value) triplets and turns them into a matrix at once
+* @details  Triplets may be added in any order. They are sorted and deduplicated
+* @details  only when the matrix is built, so building costs O(nnz + width + height).
+* @details  When the same position is added more than once, the last value wins, same as with SetAt,
+* @details  even if it's zero. Zeroes are dropped after that, so they aren't stored.
+*/
+class TripletBuilder
+{
+  int width;
+  int height;
+  std::vector<int> xs;
+  std::vector<int> ys;
+  std::vector<double> vals;
+  long long nonZeros;
+
+public:
+  TripletBuilder(int width, int height);
+
+  /**
+  * @fn        Reserve
+  * @brief     Reserves space for count triplets
+  */
+  void Reserve(size_t count);
+
+  /**
+  * @fn        Add
+  * @brief     Adds value at x,y position
+  * @details   Zero is recorded too, so that it overwrites an earlier value at the same position.
+  */
+  void Add(int x, int y, double val);
+
+  /**
+  * @fn        GetCount
+  * @returns   Number of triplets added so far
+  */
+  int GetCount() const;
+
+  /**
+  * @fn        Build
+  * @returns   New SparseMatrix holding the triplets
+  * @details   The builder is emptied.
+  */
+  SparseMatrix * Build();
+
+  /**
+  * @fn        BuildDense
+  * @returns   New DenseMatrix holding the triplets
+  * @details   The builder is emptied.
+  */
+  DenseMatrix * BuildDense();
+
+  /**
+  * @fn        BuildPreferred
+  * @returns   Either Dense or SparseMatrix, whichever suits the number of zeroes
+  * @details   The builder is emptied.
+  */
+  Matrix * BuildPreferred();
+
+  /**
+  * @fn        PreferSparse
+  * @returns   True, if width x height matrix with nonZeros elements is smaller in SparseMatrix
+  */
+  static bool PreferSparse(int width, int height, long long nonZeros);
+};
+
+
+#endif
@@ -1,9 +1,47 @@
 #include <iostream>
+#include <fstream>
+#include <cstring>
+#include <unistd.h>
 #include "Parser.h"
 
-int main()
+/**
+* Usage: Calculator [-b | -i] [script]
+* -b runs in batch mode (no prompts, plain output), -i interactively, by default batch mode
+* is used, when the input isn't a terminal. Exit status is 1, if any command failed.
+*/
+int main(int argc, char ** argv)
 {
-  Parser p;
-  p.Run();
-  return 0;
-}
\ No newline at end of file
+  int mode = 0;
+  const char * script = nullptr;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "-b") == 0)
+      mode = 'b';
+    else if (std::strcmp(argv[i], "-i") == 0)
+      mode = 'i';
+    else if (argv[i][0] != '-' && script == nullptr)
+      script = argv[i];
+    else
+    {
+      std::cerr << "Usage: " << argv[0] << " [-b | -i] [script]\n";
+      return 2;
+    }
+  }
+  std::ifstream file;
+  if (script != nullptr)
+  {
+    file.open(script);
+    if (!file)
+    {
+      std::cerr << "Cannot open " << script << '\n';
+      return 2;
+    }
+  }
+  bool batch = mode == 'b' || (mode == 0 && (script != nullptr || !isatty(STDIN_FILENO)));
+  // iostreams don't have to stay in step with stdio, output is flushed only before input in interactive mode
+  std::ios::sync_with_stdio(false);
+  if (batch)
+    std::cin.tie(nullptr);
+  Parser p(script != nullptr ? static_cast<std::istream&>(file) : std::cin, std::cout, batch);
+  return p.Run() ? 0 : 1;
+}